@@ -0,0 +1,378 @@
+<?php
+/*
+ * Times the extension's operations on synthetic inputs and reports the
+ * results as JSON, so builds can be compared before they are deployed.
+ *
+ *   php -d extension=opencv.so bench/bench.php [options]
+ *
+ *   --sizes=vga,hd,fhd      sizes to run: qvga, vga, hd, fhd, 4k, 8k
+ *   --depths=8u,16u,32f     image depths; cases skip depths they can't take
+ *   --channels=1,3          channel counts
+ *   --filter=REGEX          only run cases whose name matches
+ *   --min-time=0.5          keep repeating each case for this many seconds
+ *   --max-iterations=50     but never more than this many times
+ *   --frames=50             frames in the synthetic video for Capture cases
+ *   --seed=1                seed for the synthetic inputs
+ *   --output=FILE           write the JSON here rather than to stdout
+ *
+ * With opencv.stats_enabled=1 each result also has the peak memory held by
+ * images while the case ran.
+ */
+use OpenCV\Image as Image;
+use OpenCV\Mat as Mat;
+use OpenCV\Histogram as Histogram;
+use OpenCV\Pipeline as Pipeline;
+use OpenCV\Capture as Capture;
+use OpenCV\Stats as Stats;
+
+require_once dirname(__FILE__) . '/synthetic.php';
+
+function opencv_bench_sizes()
+{
+	return array(
+		'qvga' => array(320, 240),
+		'vga' => array(640, 480),
+		'hd' => array(1280, 720),
+		'fhd' => array(1920, 1080),
+		'4k' => array(3840, 2160),
+		'8k' => array(7680, 4320),
+	);
+}
+
+/* Each case runs once per iteration on an image of the size, depth and
+   channels being measured. 'setup' builds anything the case needs that
+   should not be timed, and is passed to 'run' along with the image. Cases
+   with 'requires' are left out when it returns false for this build. */
+function opencv_bench_cases()
+{
+	$all = array('8u', '16u', '32f');
+	$cases = array();
+
+	$cases['Image::smooth(GAUSSIAN 5x5)'] = array('depths' => $all, 'run' => function ($image) {
+		$image->smooth(Image::GAUSSIAN, 5, 5, 0, 0);
+	});
+	$cases['Image::smooth(MEDIAN 5)'] = array('depths' => array('8u'), 'run' => function ($image) {
+		$image->smooth(Image::MEDIAN, 5, 0, 0, 0);
+	});
+	$cases['Image::laplace'] = array('depths' => array('8u'), 'run' => function ($image) {
+		$image->laplace(3);
+	});
+	$cases['Image::sobel'] = array('depths' => array('8u'), 'run' => function ($image) {
+		$image->sobel(1, 0, 3);
+	});
+	$cases['Image::erode'] = array('depths' => $all, 'run' => function ($image) {
+		$image->erode(1);
+	});
+	$cases['Image::open'] = array('depths' => $all, 'run' => function ($image) {
+		$image->open(1);
+	});
+	$cases['Image::resize(half, AREA)'] = array('depths' => $all,
+		'setup' => function ($image) {
+			return new Image((int) ($image->width / 2), (int) ($image->height / 2), $image->depth, $image->nChannels);
+		},
+		'run' => function ($image, $dst) {
+			$image->resize($dst, Image::INTER_AREA);
+		});
+	$cases['Image::pyrDown'] = array('depths' => $all, 'run' => function ($image) {
+		$image->pyrDown(Image::GAUSSIAN_5x5);
+	});
+	$cases['Image::canny'] = array('depths' => array('8u'), 'run' => function ($image) {
+		$image->canny(10, 50, 3);
+	});
+	$cases['Image::convertColor(BGR2GRAY)'] = array('depths' => $all, 'channels' => array(3), 'run' => function ($image) {
+		$image->convertColor(Image::BGR2GRAY, 1);
+	});
+	$cases['Image::split'] = array('depths' => $all, 'channels' => array(3), 'run' => function ($image) {
+		$image->split();
+	});
+	$cases['Image::matchTemplate(CCORR_NORMED 64x64)'] = array('depths' => array('8u', '32f'),
+		'setup' => function ($image) {
+			$template = new Image(64, 64, $image->depth, $image->nChannels);
+			$image->view(100, 100, 64, 64)->resize($template);
+			return $template;
+		},
+		'run' => function ($image, $template) {
+			$image->matchTemplate($template, Image::TM_CCORR_NORMED);
+		});
+	$cases['Image::encode(jpg)'] = array('depths' => array('8u'), 'run' => function ($image) {
+		$image->encode('.jpg');
+	});
+	$cases['Image::decode(jpg)'] = array('depths' => array('8u'),
+		'setup' => function ($image) {
+			return $image->encode('.jpg');
+		},
+		'run' => function ($image, $jpeg) {
+			Image::decode($jpeg, $image->nChannels == 1 ? Image::LOAD_IMAGE_GRAYSCALE : Image::LOAD_IMAGE_COLOR);
+		});
+	$cases['Image::loadScaled(jpg to 320x240)'] = array('depths' => array('8u'), 'channels' => array(3),
+		'setup' => function ($image) {
+			$file = tempnam(sys_get_temp_dir(), 'ocvbench') . '.jpg';
+			$image->save($file);
+			return $file;
+		},
+		'run' => function ($image, $file) {
+			Image::loadScaled($file, 320, 240);
+		},
+		'teardown' => function ($file) {
+			unlink($file);
+		});
+	$cases['Image::getBytes'] = array('depths' => $all, 'run' => function ($image) {
+		$image->getBytes();
+	});
+	$cases['Histogram::calc(256 bins)'] = array('depths' => array('8u'), 'channels' => array(1),
+		'setup' => function ($image) {
+			return new Histogram(1, 256, Histogram::TYPE_ARRAY);
+		},
+		'run' => function ($image, $histogram) {
+			$histogram->calc($image);
+		});
+	$cases['Pipeline::run(gray, blur, open)'] = array('depths' => array('8u'), 'channels' => array(3),
+		'setup' => 'opencv_bench_pipeline',
+		'run' => function ($image, $pipeline) {
+			$pipeline->run($image);
+		});
+	$cases['Pipeline::runTiled(gray, blur, open)'] = array('depths' => array('8u'), 'channels' => array(3),
+		'setup' => 'opencv_bench_pipeline',
+		'run' => function ($image, $pipeline) {
+			$pipeline->runTiled($image, 512);
+		});
+	$cases['Mat::gaussianBlur(5x5)'] = array('depths' => $all,
+		'setup' => function ($image) {
+			return $image->toMat();
+		},
+		'run' => function ($image, $mat) {
+			$mat->gaussianBlur(5, 5);
+		});
+	$cases['Mat::threshold'] = array('depths' => array('8u', '32f'),
+		'setup' => function ($image) {
+			return $image->toMat();
+		},
+		'run' => function ($image, $mat) {
+			$mat->threshold(100, 255, Mat::THRESH_BINARY);
+		});
+	$cases['Mat::absdiff'] = array('depths' => $all,
+		'setup' => function ($image) {
+			return $image->toMat();
+		},
+		'run' => function ($image, $mat) {
+			$mat->absdiff($mat);
+		});
+	$cases['Capture::queryFrame(MJPEG)'] = array('depths' => array('8u'), 'channels' => array(3), 'per' => 'frame',
+		'requires' => 'opencv_bench_video_readable',
+		'setup' => function ($image, $options) {
+			$file = tempnam(sys_get_temp_dir(), 'ocvbench') . '.avi';
+			opencv_bench_video($file, $image->width, $image->height, $options['frames'], 25, $options['seed']);
+			return $file;
+		},
+		'run' => function ($image, $file) {
+			$capture = Capture::createFileCapture($file);
+			$frames = 0;
+			while ($capture->queryFrame()) {
+				$frames++;
+			}
+			return $frames;
+		},
+		'teardown' => function ($file) {
+			unlink($file);
+		});
+
+	return $cases;
+}
+
+function opencv_bench_pipeline()
+{
+	$pipeline = new Pipeline();
+	$pipeline->convertColor(Image::BGR2GRAY, 1)
+		->smooth(Image::GAUSSIAN, 5)
+		->open(1);
+	return $pipeline;
+}
+
+/* Works out summary figures from the per-iteration times, in seconds */
+function opencv_bench_summary(array $times)
+{
+	sort($times);
+	$count = count($times);
+	return array(
+		'iterations' => $count,
+		'min' => $times[0],
+		'mean' => array_sum($times) / $count,
+		'median' => $times[(int) (($count - 1) / 2)],
+		'p95' => $times[(int) (($count - 1) * 95 / 100)],
+		'max' => $times[$count - 1],
+	);
+}
+
+/* Runs every selected case and returns the results as an array */
+function opencv_bench_run(array $options)
+{
+	$all_sizes = opencv_bench_sizes();
+	$cases = array();
+	foreach (opencv_bench_cases() as $name => $case) {
+		if ($options['filter'] !== null && !preg_match($options['filter'], $name)) {
+			continue;
+		}
+		if (isset($case['requires']) && !call_user_func($case['requires'])) {
+			fwrite(STDERR, "Skipping $name, which this build can't run\n");
+			continue;
+		}
+		$cases[$name] = $case;
+	}
+	$stats = class_exists('OpenCV\Stats') && Stats::isEnabled();
+	$results = array();
+
+	foreach ($options['sizes'] as $size) {
+		list($width, $height) = $all_sizes[$size];
+		foreach ($options['depths'] as $depth) {
+			foreach ($options['channels'] as $channels) {
+				$image = opencv_bench_image($width, $height, $depth, $channels, $options['seed']);
+
+				foreach ($cases as $name => $case) {
+					if (!in_array($depth, $case['depths']) || (isset($case['channels']) && !in_array($channels, $case['channels']))) {
+						continue;
+					}
+
+					$context = isset($case['setup']) ? call_user_func($case['setup'], $image, $options) : null;
+					if ($stats) {
+						Stats::reset();
+					}
+
+					$times = array();
+					$units = 1;
+					$started = microtime(true);
+					do {
+						$start = microtime(true);
+						$count = call_user_func($case['run'], $image, $context);
+						$times[] = microtime(true) - $start;
+						if (is_int($count) && $count > 0) {
+							$units = $count;
+						}
+					} while (count($times) < $options['max_iterations'] && microtime(true) - $started < $options['min_time']);
+
+					$result = array(
+						'case' => $name,
+						'size' => $size,
+						'width' => $width,
+						'height' => $height,
+						'depth' => $depth,
+						'channels' => $channels,
+					) + opencv_bench_summary($times);
+
+					/* Cases that process several frames per run report per frame */
+					if (isset($case['per'])) {
+						$result['per'] = $case['per'];
+						foreach (array('min', 'mean', 'median', 'p95', 'max') as $key) {
+							$result[$key] /= $units;
+						}
+					}
+					$result['mpixels_per_second'] = $width * $height / 1e6 / $result['median'];
+
+					if ($stats) {
+						$memory = Stats::get();
+						$result['peak_image_bytes'] = $memory['memory']['peak'];
+					}
+					if (isset($case['teardown'])) {
+						call_user_func($case['teardown'], $context);
+					}
+					$context = null;
+					$results[] = $result;
+				}
+				$image = null;
+			}
+		}
+	}
+
+	return array(
+		'meta' => array(
+			'php' => PHP_VERSION,
+			'extension' => phpversion('opencv'),
+			'os' => php_uname('s') . ' ' . php_uname('r') . ' ' . php_uname('m'),
+			'date' => gmdate('c'),
+			'seed' => $options['seed'],
+			'stats' => $stats,
+		),
+		'results' => $results,
+	);
+}
+
+/* Reads --name=value options over the defaults */
+function opencv_bench_options(array $argv)
+{
+	$options = array(
+		'sizes' => array('vga', 'hd', 'fhd'),
+		'depths' => array('8u', '16u', '32f'),
+		'channels' => array(1, 3),
+		'filter' => null,
+		'min_time' => 0.5,
+		'max_iterations' => 50,
+		'frames' => 50,
+		'seed' => 1,
+		'output' => null,
+	);
+
+	foreach (array_slice($argv, 1) as $arg) {
+		if (!preg_match('/^--([a-z-]+)=(.*)$/', $arg, $matches)) {
+			fwrite(STDERR, "Unknown argument $arg\n");
+			exit(1);
+		}
+		$key = str_replace('-', '_', $matches[1]);
+		$value = $matches[2];
+		switch ($key) {
+			case 'sizes':
+			case 'depths':
+				$options[$key] = explode(',', strtolower($value));
+				break;
+			case 'channels':
+				$options[$key] = array_map('intval', explode(',', $value));
+				break;
+			case 'min_time':
+				$options[$key] = (float) $value;
+				break;
+			case 'max_iterations':
+			case 'frames':
+			case 'seed':
+				$options[$key] = max(1, (int) $value);
+				break;
+			case 'filter':
+				$options[$key] = '/' . str_replace('/', '\/', $value) . '/i';
+				break;
+			case 'output':
+				$options[$key] = $value;
+				break;
+			default:
+				fwrite(STDERR, "Unknown option --{$matches[1]}\n");
+				exit(1);
+		}
+	}
+
+	$sizes = opencv_bench_sizes();
+	$depths = opencv_bench_depths();
+	foreach ($options['sizes'] as $size) {
+		if (!isset($sizes[$size])) {
+			fwrite(STDERR, "Unknown size $size\n");
+			exit(1);
+		}
+	}
+	foreach ($options['depths'] as $depth) {
+		if (!isset($depths[$depth])) {
+			fwrite(STDERR, "Unknown depth $depth\n");
+			exit(1);
+		}
+	}
+	return $options;
+}
+
+if (isset($_SERVER['SCRIPT_FILENAME']) && realpath($_SERVER['SCRIPT_FILENAME']) === __FILE__) {
+	if (!extension_loaded('opencv')) {
+		fwrite(STDERR, "The opencv extension is not loaded\n");
+		exit(1);
+	}
+
+	$options = opencv_bench_options($argv);
+	$json = json_encode(opencv_bench_run($options));
+	if ($options['output'] !== null) {
+		file_put_contents($options['output'], $json . "\n");
+	} else {
+		echo $json, "\n";
+	}
+}
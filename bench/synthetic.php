@@ -0,0 +1,96 @@
+<?php
+/*
+ * Reproducible synthetic inputs for the benchmarks. Everything is generated
+ * from a seed, so two runs on different machines time the same pixels.
+ */
+use OpenCV\Image as Image;
+use OpenCV\Mat as Mat;
+
+/* Depth names used on the command line, and the matching Image and Mat
+   depths. Mat types are depth + (channels - 1) * 8. */
+function opencv_bench_depths()
+{
+	return array(
+		'8u' => array(Image::DEPTH_8U, 0, 1.0),
+		'16u' => array(Image::DEPTH_16U, 2, 257.0),
+		'32f' => array(Image::DEPTH_32F, 5, 1.0 / 255),
+	);
+}
+
+/* Makes a width x height image of smooth noise: a small tile of seeded
+   random pixels, scaled up with cubic interpolation */
+function opencv_bench_image($width, $height, $depth, $channels, $seed = 1)
+{
+	mt_srand($seed);
+	$tile_width = 64;
+	$tile_height = 48;
+	$data = '';
+	for ($i = 0; $i < $tile_width * $tile_height * $channels; $i++) {
+		$data .= chr(mt_rand(0, 255));
+	}
+	$tile = Image::fromBytes($data, $tile_width, $tile_height, Image::DEPTH_8U, $channels);
+
+	$image = new Image($width, $height, Image::DEPTH_8U, $channels);
+	$tile->resize($image, Image::INTER_CUBIC);
+	if ($depth == '8u') {
+		return $image;
+	}
+
+	$depths = opencv_bench_depths();
+	list(, $mat_depth, $scale) = $depths[$depth];
+	$mat = $image->toMat()->convertTo($mat_depth + ($channels - 1) * 8, $scale);
+	return $mat->toImage();
+}
+
+/* Writes an MJPEG AVI of a synthetic scene panning across a larger image,
+   which every OpenCV video backend can read */
+function opencv_bench_video($file, $width, $height, $frames, $fps = 25, $seed = 1)
+{
+	$scene = opencv_bench_image($width + $frames * 4, $height + $frames * 2, '8u', 3, $seed);
+
+	$chunks = array();
+	for ($i = 0; $i < $frames; $i++) {
+		$chunks[] = $scene->view($i * 4, $i * 2, $width, $height)->encode('.jpg', array(Image::IMWRITE_JPEG_QUALITY, 90));
+	}
+
+	$movi = '';
+	$index = '';
+	$largest = 0;
+	foreach ($chunks as $chunk) {
+		$size = strlen($chunk);
+		$largest = max($largest, $size);
+		/* Offsets are from the start of the 'movi' fourcc */
+		$index .= '00dc' . pack('VVV', 0x10, 4 + strlen($movi), $size);
+		$movi .= '00dc' . pack('V', $size) . $chunk . ($size % 2 ? "\0" : '');
+	}
+
+	$avih = pack('VVVVVVVVVVVVVV', (int) (1000000 / $fps), 0, 0, 0x10, $frames, 0, 1, $largest, $width, $height, 0, 0, 0, 0);
+	$strh = 'vids' . 'MJPG' . pack('VvvVVVVVVVVvvvv', 0, 0, 0, 0, 1, $fps, 0, $frames, $largest, -1, 0, 0, 0, $width, $height);
+	$strf = pack('VVVvv', 40, $width, $height, 1, 24) . 'MJPG' . pack('VVVVV', $width * $height * 3, 0, 0, 0, 0);
+
+	$strl = 'strl' . opencv_bench_chunk('strh', $strh) . opencv_bench_chunk('strf', $strf);
+	$hdrl = 'hdrl' . opencv_bench_chunk('avih', $avih) . opencv_bench_chunk('LIST', $strl);
+	$body = 'AVI ' . opencv_bench_chunk('LIST', $hdrl) . opencv_bench_chunk('LIST', 'movi' . $movi) . opencv_bench_chunk('idx1', $index);
+
+	return file_put_contents($file, opencv_bench_chunk('RIFF', $body)) !== false;
+}
+
+/* Whether this build's video backend can read the videos written above */
+function opencv_bench_video_readable()
+{
+	$file = tempnam(sys_get_temp_dir(), 'ocvvideo') . '.avi';
+	opencv_bench_video($file, 64, 48, 2);
+	try {
+		$capture = OpenCV\Capture::createFileCapture($file);
+		$readable = $capture->queryFrame() !== false;
+	} catch (OpenCV\Exception $e) {
+		$readable = false;
+	}
+	unlink($file);
+	return $readable;
+}
+
+function opencv_bench_chunk($fourcc, $data)
+{
+	return $fourcc . pack('V', strlen($data)) . $data . (strlen($data) % 2 ? "\0" : '');
+}
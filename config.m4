@@ -23,11 +23,21 @@ if test "$PHP_OPENCV" != "no"; then
   PHP_REQUIRE_CXX()
   PHP_SUBST(OPENCV_SHARED_LIBADD)
   PHP_ADD_LIBRARY(stdc++, 1, OPENCV_SHARED_LIBADD)
+  PHP_ADD_LIBRARY(pthread, 1, OPENCV_SHARED_LIBADD)
+  PHP_CHECK_LIBRARY(rt, shm_open, [
+    PHP_ADD_LIBRARY(rt, 1, OPENCV_SHARED_LIBADD)
+  ])
+  AC_CHECK_HEADER(jpeglib.h, [
+    PHP_CHECK_LIBRARY(jpeg, jpeg_read_header, [
+      PHP_ADD_LIBRARY(jpeg, 1, OPENCV_SHARED_LIBADD)
+      AC_DEFINE(HAVE_OPENCV_JPEG, 1, [whether libjpeg is available for scaled JPEG loading])
+    ])
+  ])
   AC_DEFINE(HAVE_OPENCV, 1, [ ])
 
   PHP_NEW_EXTENSION(
 	opencv, 
-	opencv.cpp opencv_error.cpp opencv_mat.cpp opencv_image.cpp opencv_histogram.cpp opencv_capture.cpp, 
+	opencv.cpp opencv_error.cpp opencv_mat.cpp opencv_image.cpp opencv_histogram.cpp opencv_capture.cpp opencv_cascade.cpp opencv_pipeline.cpp opencv_batch.cpp opencv_match.cpp opencv_shared.cpp opencv_scaled.cpp opencv_pool.cpp opencv_stats.cpp, 
 	$ext_shared,
 	,
 	,
@@ -0,0 +1,22 @@
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Batch as Batch;
+use OpenCV\Pipeline as Pipeline;
+
+/* Thumbnail a whole gallery, spread over every core */
+$files = array();
+foreach (glob("gallery/*.jpg") as $file) {
+	$files[$file] = "thumbs/" . basename($file);
+}
+$results = Batch::resize($files, 200, 200, Image::INTER_AREA);
+foreach ($results as $file => $ok) {
+	echo $file, ": ", $ok ? "ok" : "failed", "\n";
+}
+
+/* Or load the images and run a pipeline over them in parallel */
+$images = Batch::load(array_keys($files), Image::LOAD_IMAGE_COLOR);
+$edges = new Pipeline();
+$edges->convertColor(Image::BGR2GRAY, 1)->canny(10, 50, 3);
+foreach (Batch::run($edges, array_filter($images), 4) as $file => $result) {
+	$result->save("edges/" . basename($file));
+}
@@ -0,0 +1,22 @@
+<?php
+use OpenCV\Image as Image;
+use OpenCV\CascadeClassifier as CascadeClassifier;
+
+/* Load the cascade once and reuse it for every image */
+$cascade = new CascadeClassifier("/usr/share/opencv/haarcascades/haarcascade_frontalface_default.xml");
+
+foreach (array("sailing.jpg", "test.jpg") as $file) {
+	$i = Image::load($file, Image::LOAD_IMAGE_COLOR);
+	/* Larger steps and a bigger minimum size trade recall for speed */
+	$result = $cascade->detectMultiScale($i, array(
+		'scaleFactor' => 1.2,
+		'minNeighbors' => 3,
+		'minSize' => array(40, 40),
+		'flags' => CascadeClassifier::HAAR_DO_CANNY_PRUNING,
+	));
+
+	foreach ($result as $r) {
+		$i->rectangle($r['x'], $r['y'], $r['width'], $r['height']);
+	}
+	$i->save("cascade_$file");
+}
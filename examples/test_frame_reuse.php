@@ -0,0 +1,11 @@
+<?php
+use OpenCV\Capture as Capture;
+
+/* The first frame allocates; every later frame is decoded into the same image */
+$capture = Capture::createFileCapture('movie.avi');
+$frame = $capture->queryFrame();
+$count = 0;
+while ($frame && $capture->queryFrame($frame)) {
+	$count++;
+}
+echo "Read $count frames\n";
@@ -0,0 +1,16 @@
+<?php
+use OpenCV\Capture as Capture;
+
+$capture = Capture::createFileCapture('movie.avi');
+
+/* Every frame */
+$count = 0;
+foreach ($capture as $number => $frame) {
+	$count++;
+}
+echo "Read $count frames\n";
+
+/* One frame in every 25 between 10 and 20 seconds, seeking over the rest */
+foreach ($capture->frames(25, 10000, 20000, true) as $number => $frame) {
+	$frame->save("frame-$number.jpg");
+}
@@ -0,0 +1,16 @@
+<?php
+use OpenCV\Image as Image;
+
+$i = Image::load("test.jpg", Image::LOAD_IMAGE_COLOR);
+
+/* Each step writes back into the same buffer, so no new frames are allocated */
+$i->smooth(Image::GAUSSIAN, 5, 0, 0, 0, $i)
+  ->erode(1, $i)
+  ->dilate(2, $i)
+  ->close(1, $i);
+$i->save("test_in_place.jpg");
+
+/* Or reuse a scratch image across calls */
+$scratch = new Image($i->width, $i->height, $i->depth, $i->nChannels);
+$i->topHat(1, $scratch);
+$scratch->save("test_tophat.jpg");
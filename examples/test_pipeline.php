@@ -0,0 +1,20 @@
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Capture as Capture;
+use OpenCV\Pipeline as Pipeline;
+
+/* Declare the steps once; intermediate buffers are reused for every frame */
+$edges = new Pipeline();
+$edges->convertColor(Image::BGR2GRAY, 1)
+	->smooth(Image::GAUSSIAN, 5)
+	->canny(10, 50, 3)
+	->dilate(1);
+
+$capture = Capture::createFileCapture('movie.avi');
+for ($frame = 0; $frame < 100; $frame++) {
+	$image = $capture->queryFrame();
+	if (!$image) {
+		break;
+	}
+	$edges->run($image)->save("edges_$frame.png");
+}
@@ -0,0 +1,15 @@
+<?php
+use OpenCV\Capture as Capture;
+
+/* Decode up to 8 frames ahead on a background thread while this loop works */
+$capture = Capture::createFileCapture('movie.avi', array('prefetch' => 8));
+$count = 0;
+while ($frame = $capture->queryFrame()) {
+	$frame->smooth(OpenCV\Image::GAUSSIAN, 5, 5, 0, 0);
+	$count++;
+}
+echo "Read $count frames\n";
+
+/* Seeking drops whatever was decoded ahead */
+$capture->setProperty(Capture::PROP_POS_FRAMES, 0);
+var_dump($capture->getProperty(Capture::PROP_POS_FRAMES));
@@ -0,0 +1,21 @@
+<?php
+use OpenCV\Image as Image;
+use OpenCV\SharedImage as SharedImage;
+use OpenCV\Capture as Capture;
+
+/* Producer: decode frames straight into a shared segment */
+$capture = Capture::createFileCapture('movie.avi');
+$first = $capture->queryFrame();
+$shared = SharedImage::fromImage('/opencv-frame', $first);
+
+if (pcntl_fork() == 0) {
+	/* Consumer: another process sees the same pixels without copying */
+	$frame = SharedImage::open('/opencv-frame');
+	echo "Consumer sees {$frame->width}x{$frame->height}\n";
+	$frame->save('shared_frame.jpg');
+	exit(0);
+}
+
+pcntl_wait($status);
+$capture->queryFrame($shared);
+SharedImage::unlink('/opencv-frame');
@@ -0,0 +1,18 @@
+<?php
+use OpenCV\Image as Image;
+
+$logo = Image::load("elephpant_sample.jpg", Image::LOAD_IMAGE_COLOR);
+$frame = Image::load("dragonbe_elephpants.jpg", Image::LOAD_IMAGE_COLOR);
+
+$hits = $frame->matchTemplateMultiScale($logo, Image::TM_CCOEFF_NORMED, array(
+	'scales' => array(0.5, 0.75, 1.0, 1.5),
+	'levels' => 2,
+	'threshold' => 0.7,
+	'maxCount' => 5,
+));
+
+foreach ($hits as $hit) {
+	printf("%d,%d %dx%d score %.3f at scale %.2f\n", $hit['x'], $hit['y'], $hit['width'], $hit['height'], $hit['score'], $hit['scale']);
+	$frame->rectangle($hit['x'], $hit['y'], $hit['width'], $hit['height']);
+}
+$frame->save("mt_multiscale.jpg");
@@ -29,9 +29,7 @@ extern "C" {
 #include "ext/standard/info.h"
 }
 
-/* If you declare any globals in php_opencv.h uncomment this:
 ZEND_DECLARE_MODULE_GLOBALS(opencv)
-*/
 
 /* True global resources - no need for thread safety here */
 static int le_opencv;
@@ -58,6 +56,98 @@ PHP_OPENCV_API void php_opencv_basedir_check(const char *filename TSRMLS_DC) {
 	}
 }
 
+/* Flattens a PHP array of (flag, value) pairs into the int list that the
+   imwrite/imencode family expects */
+PHP_OPENCV_API void php_opencv_array_to_params(zval *params_zval, std::vector<int> &params TSRMLS_DC) {
+	HashPosition pos;
+	zval **ppzval;
+
+	if (params_zval == NULL) {
+		return;
+	}
+
+	for (zend_hash_internal_pointer_reset_ex(Z_ARRVAL_P(params_zval), &pos);
+			zend_hash_get_current_data_ex(Z_ARRVAL_P(params_zval), (void **) &ppzval, &pos) == SUCCESS;
+			zend_hash_move_forward_ex(Z_ARRVAL_P(params_zval), &pos)) {
+		zval tmp = **ppzval;
+		zval_copy_ctor(&tmp);
+		convert_to_long(&tmp);
+		params.push_back((int) Z_LVAL(tmp));
+	}
+}
+
+/* Releases a zval kept as the backing of an image or Mat, such as the
+   object whose pixels it shares */
+PHP_OPENCV_API void php_opencv_release_zval(void *backing TSRMLS_DC) {
+	zval *owner = (zval *) backing;
+
+	zval_ptr_dtor(&owner);
+}
+
+/* Looks up a key in an optional options array */
+PHP_OPENCV_API zval *php_opencv_option_find(zval *options_zval, const char *key) {
+	zval **ppzval;
+
+	if (options_zval == NULL || Z_TYPE_P(options_zval) != IS_ARRAY) {
+		return NULL;
+	}
+	if (zend_hash_find(Z_ARRVAL_P(options_zval), (char *) key, strlen(key) + 1, (void **) &ppzval) == FAILURE) {
+		return NULL;
+	}
+	return *ppzval;
+}
+
+PHP_OPENCV_API long php_opencv_option_long(zval *options_zval, const char *key, long def) {
+	zval *value = php_opencv_option_find(options_zval, key), tmp;
+
+	if (value == NULL) {
+		return def;
+	}
+	tmp = *value;
+	zval_copy_ctor(&tmp);
+	convert_to_long(&tmp);
+	return Z_LVAL(tmp);
+}
+
+PHP_OPENCV_API double php_opencv_option_double(zval *options_zval, const char *key, double def) {
+	zval *value = php_opencv_option_find(options_zval, key), tmp;
+
+	if (value == NULL) {
+		return def;
+	}
+	tmp = *value;
+	zval_copy_ctor(&tmp);
+	convert_to_double(&tmp);
+	return Z_DVAL(tmp);
+}
+
+/* Reads a size given either as a single number for a square or as
+   array(width, height) */
+PHP_OPENCV_API CvSize php_opencv_option_size(zval *options_zval, const char *key, CvSize def) {
+	zval *value = php_opencv_option_find(options_zval, key), **ppzval, tmp;
+	long dims[2];
+	int i;
+
+	if (value == NULL) {
+		return def;
+	}
+	if (Z_TYPE_P(value) != IS_ARRAY) {
+		dims[0] = dims[1] = php_opencv_option_long(options_zval, key, 0);
+		return cvSize(dims[0], dims[1]);
+	}
+
+	for (i = 0; i < 2; i++) {
+		if (zend_hash_index_find(Z_ARRVAL_P(value), i, (void **) &ppzval) == FAILURE) {
+			return def;
+		}
+		tmp = **ppzval;
+		zval_copy_ctor(&tmp);
+		convert_to_long(&tmp);
+		dims[i] = Z_LVAL(tmp);
+	}
+	return cvSize(dims[0], dims[1]);
+}
+
 zend_class_entry *opencv_ce_cv;
 /* {{{ proto void contruct()
    OpenCV CANNOT be extended in userspace, this will throw an exception on use */
@@ -67,6 +157,53 @@ PHP_METHOD(OpenCV, __construct)
 }
 /* }}} */
 
+/* {{{ PHP_INI
+ */
+PHP_INI_BEGIN()
+	STD_PHP_INI_ENTRY("opencv.cascade_cache_size", "8", PHP_INI_SYSTEM, OnUpdateLong, cascade_cache_size, zend_opencv_globals, opencv_globals)
+	STD_PHP_INI_ENTRY("opencv.batch_threads", "0", PHP_INI_ALL, OnUpdateLong, batch_threads, zend_opencv_globals, opencv_globals)
+	STD_PHP_INI_ENTRY("opencv.image_pool_size", "16", PHP_INI_ALL, OnUpdateLong, image_pool_size, zend_opencv_globals, opencv_globals)
+	STD_PHP_INI_ENTRY("opencv.image_pool_memory", "64", PHP_INI_ALL, OnUpdateLong, image_pool_memory, zend_opencv_globals, opencv_globals)
+	STD_PHP_INI_BOOLEAN("opencv.stats_enabled", "0", PHP_INI_ALL, OnUpdateBool, stats_enabled, zend_opencv_globals, opencv_globals)
+PHP_INI_END()
+/* }}} */
+
+/* {{{ php_opencv_init_globals
+ */
+static void php_opencv_init_globals(zend_opencv_globals *opencv_globals)
+{
+	opencv_globals->cascade_cache_size = 8;
+	opencv_globals->batch_threads = 0;
+	opencv_globals->haar_storage = NULL;
+	opencv_globals->image_pool_size = 16;
+	opencv_globals->image_pool_memory = 64;
+	opencv_globals->image_pool = NULL;
+	opencv_globals->image_pool_count = 0;
+	opencv_globals->image_pool_capacity = 0;
+	opencv_globals->image_pool_bytes = 0;
+	opencv_globals->image_pool_hits = 0;
+	opencv_globals->image_pool_misses = 0;
+	opencv_globals->image_pool_discards = 0;
+	opencv_globals->stats_enabled = 0;
+	opencv_globals->stats = NULL;
+	opencv_globals->stats_images = 0;
+	opencv_globals->stats_image_bytes = 0;
+	opencv_globals->stats_image_peak = 0;
+}
+/* }}} */
+
+/* {{{ php_opencv_shutdown_globals
+ */
+static void php_opencv_shutdown_globals(zend_opencv_globals *opencv_globals)
+{
+	if (opencv_globals->haar_storage != NULL) {
+		cvReleaseMemStorage(&opencv_globals->haar_storage);
+	}
+	php_opencv_image_pool_clear(opencv_globals);
+	php_opencv_stats_free(&opencv_globals->stats);
+}
+/* }}} */
+
 /* {{{ opencv_functions[]
  *
  * Every user visible function must have an entry in opencv_functions[].
@@ -104,15 +241,19 @@ ZEND_GET_MODULE(opencv)
  */
 PHP_MINIT_FUNCTION(opencv)
 {
-	/* If you have INI entries, uncomment these lines 
+	ZEND_INIT_MODULE_GLOBALS(opencv, php_opencv_init_globals, php_opencv_shutdown_globals);
 	REGISTER_INI_ENTRIES();
-	*/
 
 	PHP_MINIT(opencv_error)(INIT_FUNC_ARGS_PASSTHRU);
 	PHP_MINIT(opencv_mat)(INIT_FUNC_ARGS_PASSTHRU);
 	PHP_MINIT(opencv_image)(INIT_FUNC_ARGS_PASSTHRU);
 	PHP_MINIT(opencv_histogram)(INIT_FUNC_ARGS_PASSTHRU);
 	PHP_MINIT(opencv_capture)(INIT_FUNC_ARGS_PASSTHRU);
+	PHP_MINIT(opencv_cascade)(INIT_FUNC_ARGS_PASSTHRU);
+	PHP_MINIT(opencv_pipeline)(INIT_FUNC_ARGS_PASSTHRU);
+	PHP_MINIT(opencv_batch)(INIT_FUNC_ARGS_PASSTHRU);
+	PHP_MINIT(opencv_shared)(INIT_FUNC_ARGS_PASSTHRU);
+	PHP_MINIT(opencv_stats)(INIT_FUNC_ARGS_PASSTHRU);
 	cvSetErrMode(CV_ErrModeSilent);
 	return SUCCESS;
 }
@@ -122,9 +263,12 @@ PHP_MINIT_FUNCTION(opencv)
  */
 PHP_MSHUTDOWN_FUNCTION(opencv)
 {
-	/* uncomment this line if you have INI entries
+	PHP_MSHUTDOWN(opencv_cascade)(SHUTDOWN_FUNC_ARGS_PASSTHRU);
+	PHP_MSHUTDOWN(opencv_stats)(SHUTDOWN_FUNC_ARGS_PASSTHRU);
 	UNREGISTER_INI_ENTRIES();
-	*/
+#ifndef ZTS
+	php_opencv_shutdown_globals(&opencv_globals);
+#endif
 	return SUCCESS;
 }
 /* }}} */
@@ -145,9 +289,35 @@ PHP_MINFO_FUNCTION(opencv)
 	php_info_print_table_row(2, "OpenCV library version", CV_VERSION);
 	php_info_print_table_end();
 
-	/* Remove comments if you have entries in php.ini
+	php_info_print_table_start();
+	php_info_print_table_header(2, "Haar cascade cache", "Value");
+	{
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%d", php_opencv_cascade_cache_count());
+		php_info_print_table_row(2, "Cached cascades", buf);
+	}
+	php_info_print_table_end();
+
+	php_info_print_table_start();
+	php_info_print_table_header(2, "Image pool", "Value");
+	{
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%d", OPENCV_G(image_pool_count));
+		php_info_print_table_row(2, "Pooled images", buf);
+		snprintf(buf, sizeof(buf), "%lu", (unsigned long) OPENCV_G(image_pool_bytes));
+		php_info_print_table_row(2, "Pooled bytes", buf);
+		snprintf(buf, sizeof(buf), "%lu", OPENCV_G(image_pool_hits));
+		php_info_print_table_row(2, "Reused", buf);
+		snprintf(buf, sizeof(buf), "%lu", OPENCV_G(image_pool_misses));
+		php_info_print_table_row(2, "Allocated", buf);
+		snprintf(buf, sizeof(buf), "%lu", OPENCV_G(image_pool_discards));
+		php_info_print_table_row(2, "Freed", buf);
+	}
+	php_info_print_table_end();
+
+	php_opencv_stats_info(TSRMLS_C);
+
 	DISPLAY_INI_ENTRIES();
-	*/
 }
 /* }}} */
 
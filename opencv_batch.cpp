@@ -0,0 +1,491 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 5                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2010 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Author: Michael Maclean <mgdm@php.net>                               |
+  +----------------------------------------------------------------------+
+*/
+
+/* $Id$ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php_opencv.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#define PHP_OPENCV_MAX_THREADS 64
+
+zend_class_entry *opencv_ce_batch;
+
+typedef struct _php_opencv_parallel_state {
+    pthread_mutex_t lock;
+    int next_task;
+    int task_count;
+    php_opencv_task_func func;
+    void *ctx;
+} php_opencv_parallel_state;
+
+typedef struct _php_opencv_parallel_worker {
+    php_opencv_parallel_state *state;
+    int worker;
+} php_opencv_parallel_worker;
+
+static void *php_opencv_parallel_worker_main(void *arg)
+{
+    php_opencv_parallel_worker *worker = (php_opencv_parallel_worker *) arg;
+    php_opencv_parallel_state *state = worker->state;
+    int task;
+
+    for (;;) {
+        pthread_mutex_lock(&state->lock);
+        task = state->next_task < state->task_count ? state->next_task++ : -1;
+        pthread_mutex_unlock(&state->lock);
+
+        if (task < 0) {
+            break;
+        }
+        state->func(state->ctx, task, worker->worker);
+    }
+    return NULL;
+}
+
+/* {{{ php_opencv_thread_count
+   Works out how many threads to use: an explicit request wins, then the
+   opencv.batch_threads setting, then the number of online CPUs */
+PHP_OPENCV_API int php_opencv_thread_count(long requested TSRMLS_DC)
+{
+    long count = requested;
+
+    if (count <= 0) {
+        count = OPENCV_G(batch_threads);
+    }
+    if (count <= 0) {
+        count = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (count <= 0) {
+        count = 1;
+    }
+    return count > PHP_OPENCV_MAX_THREADS ? PHP_OPENCV_MAX_THREADS : (int) count;
+}
+/* }}} */
+
+/* {{{ php_opencv_parallel_run
+   Runs func for every task on up to thread_count threads and returns once
+   they have all finished. The calling thread does its share of the work, so
+   this still completes if no extra threads could be started. */
+PHP_OPENCV_API void php_opencv_parallel_run(int task_count, int thread_count, php_opencv_task_func func, void *ctx)
+{
+    php_opencv_parallel_state state;
+    php_opencv_parallel_worker workers[PHP_OPENCV_MAX_THREADS];
+    pthread_t threads[PHP_OPENCV_MAX_THREADS];
+    zend_bool started[PHP_OPENCV_MAX_THREADS];
+    int i;
+
+    if (thread_count > task_count) {
+        thread_count = task_count;
+    }
+    if (thread_count > PHP_OPENCV_MAX_THREADS) {
+        thread_count = PHP_OPENCV_MAX_THREADS;
+    }
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+
+    pthread_mutex_init(&state.lock, NULL);
+    state.next_task = 0;
+    state.task_count = task_count;
+    state.func = func;
+    state.ctx = ctx;
+
+    for (i = 0; i < thread_count; i++) {
+        workers[i].state = &state;
+        workers[i].worker = i;
+        started[i] = 0;
+    }
+
+    for (i = 1; i < thread_count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, php_opencv_parallel_worker_main, &workers[i]) == 0;
+    }
+
+    php_opencv_parallel_worker_main(&workers[0]);
+
+    for (i = 1; i < thread_count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    pthread_mutex_destroy(&state.lock);
+}
+/* }}} */
+
+/* Copies the key at pos in the source array into the result array */
+static void php_opencv_batch_add_result(zval *return_value, HashTable *source, HashPosition *pos, zval *value)
+{
+    char *key;
+    uint key_len;
+    ulong index;
+
+    if (zend_hash_get_current_key_ex(source, &key, &key_len, &index, 0, pos) == HASH_KEY_IS_STRING) {
+        add_assoc_zval_ex(return_value, key, key_len, value);
+    } else {
+        add_index_zval(return_value, index, value);
+    }
+}
+
+typedef struct _php_opencv_batch_resize {
+    const char **sources;
+    const char **destinations;
+    zend_bool *results;
+    long width;
+    long height;
+    long interpolation;
+} php_opencv_batch_resize;
+
+static void php_opencv_batch_resize_task(void *ctx, int task, int worker)
+{
+    php_opencv_batch_resize *batch = (php_opencv_batch_resize *) ctx;
+    IplImage *dst = NULL;
+
+    try {
+        /* Fit inside the box, keeping the aspect ratio */
+        dst = php_opencv_load_scaled(batch->sources[task], batch->width, batch->height, CV_LOAD_IMAGE_UNCHANGED, 1, batch->interpolation);
+        if (dst != NULL) {
+            batch->results[task] = cvSaveImage(batch->destinations[task], dst, 0) != 0;
+        }
+    } catch (cv::Exception &e) {
+        batch->results[task] = 0;
+    }
+
+    if (cvGetErrStatus() < 0) {
+        batch->results[task] = 0;
+        cvSetErrStatus(CV_StsOk);
+    }
+    if (dst != NULL) {
+        cvReleaseImage(&dst);
+    }
+}
+
+typedef struct _php_opencv_batch_load {
+    const char **sources;
+    IplImage **results;
+    long mode;
+} php_opencv_batch_load;
+
+static void php_opencv_batch_load_task(void *ctx, int task, int worker)
+{
+    php_opencv_batch_load *batch = (php_opencv_batch_load *) ctx;
+
+    try {
+        batch->results[task] = cvLoadImage(batch->sources[task], batch->mode);
+    } catch (cv::Exception &e) {
+        batch->results[task] = NULL;
+    }
+    if (cvGetErrStatus() < 0) {
+        cvSetErrStatus(CV_StsOk);
+    }
+}
+
+typedef struct _php_opencv_batch_pipeline {
+    const php_opencv_pipeline_op *ops;
+    int op_count;
+    IplImage **sources;
+    IplImage **results;
+    php_opencv_pipeline_buffers *buffers;
+    char (*errors)[256];
+} php_opencv_batch_pipeline;
+
+static void php_opencv_batch_pipeline_task(void *ctx, int task, int worker)
+{
+    php_opencv_batch_pipeline *batch = (php_opencv_batch_pipeline *) ctx;
+    php_opencv_pipeline_buffers *buffers = &batch->buffers[worker];
+
+    if (php_opencv_pipeline_exec(batch->ops, batch->op_count, batch->sources[task], buffers) != NULL) {
+        batch->results[task] = php_opencv_pipeline_take_result(buffers);
+    } else {
+        /* The buffers are reset on the next run, so keep the message */
+        memcpy(batch->errors[worker], buffers->error, sizeof(buffers->error));
+    }
+}
+
+/* {{{ proto void __construct()
+   OpenCV\Batch only has static methods */
+PHP_METHOD(OpenCV_Batch, __construct)
+{
+    zend_throw_exception(opencv_ce_cvexception, "OpenCV\\Batch cannot be constructed", 0 TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto array resize(array files, int width, int height [, int interpolation [, int threads]])
+       Resizes each source file to fit within width x height and saves it to
+       the destination, given as an array of source => destination. Returns
+       an array of source => bool. */
+PHP_METHOD(OpenCV_Batch, resize)
+{
+    zval *files_zval, **entry;
+    HashTable *files;
+    HashPosition pos;
+    php_opencv_batch_resize batch;
+    long width, height, interpolation = CV_INTER_AREA, threads = 0;
+    char *key;
+    uint key_len;
+    ulong index;
+    int count, i;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "all|ll", &files_zval, &width, &height, &interpolation, &threads) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    if (width <= 0 || height <= 0) {
+        zend_throw_exception(opencv_ce_cvexception, "The width and height must be greater than zero", 0 TSRMLS_CC);
+        return;
+    }
+
+    files = Z_ARRVAL_P(files_zval);
+    count = zend_hash_num_elements(files);
+    array_init(return_value);
+    if (count == 0) {
+        return;
+    }
+
+    batch.sources = (const char **) ecalloc(count, sizeof(char *));
+    batch.destinations = (const char **) ecalloc(count, sizeof(char *));
+    batch.results = (zend_bool *) ecalloc(count, sizeof(zend_bool));
+    batch.width = width;
+    batch.height = height;
+    batch.interpolation = interpolation;
+
+    /* Everything that needs the engine is checked up front */
+    for (i = 0, zend_hash_internal_pointer_reset_ex(files, &pos);
+            zend_hash_get_current_data_ex(files, (void **) &entry, &pos) == SUCCESS;
+            zend_hash_move_forward_ex(files, &pos), i++) {
+        if (zend_hash_get_current_key_ex(files, &key, &key_len, &index, 0, &pos) != HASH_KEY_IS_STRING || Z_TYPE_PP(entry) != IS_STRING) {
+            zend_throw_exception(opencv_ce_cvexception, "Files must be given as an array of source => destination filenames", 0 TSRMLS_CC);
+            goto cleanup;
+        }
+        php_opencv_basedir_check(key TSRMLS_CC);
+        php_opencv_basedir_check(Z_STRVAL_PP(entry) TSRMLS_CC);
+        if (EG(exception)) {
+            goto cleanup;
+        }
+        batch.sources[i] = key;
+        batch.destinations[i] = Z_STRVAL_PP(entry);
+    }
+
+    php_opencv_parallel_run(count, php_opencv_thread_count(threads TSRMLS_CC), php_opencv_batch_resize_task, &batch);
+
+    for (i = 0, zend_hash_internal_pointer_reset_ex(files, &pos);
+            zend_hash_get_current_data_ex(files, (void **) &entry, &pos) == SUCCESS;
+            zend_hash_move_forward_ex(files, &pos), i++) {
+        zend_hash_get_current_key_ex(files, &key, &key_len, &index, 0, &pos);
+        add_assoc_bool_ex(return_value, key, key_len, batch.results[i]);
+    }
+
+cleanup:
+    efree(batch.sources);
+    efree(batch.destinations);
+    efree(batch.results);
+}
+/* }}} */
+
+/* {{{ proto array load(array files [, int mode [, int threads]])
+       Loads each file into an Image in parallel, keeping the array keys.
+       Files that can't be loaded map to false. */
+PHP_METHOD(OpenCV_Batch, load)
+{
+    zval *files_zval, **entry, *image_zval;
+    HashTable *files;
+    HashPosition pos;
+    php_opencv_batch_load batch;
+    long mode = CV_LOAD_IMAGE_COLOR, threads = 0;
+    int count, i;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "a|ll", &files_zval, &mode, &threads) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    files = Z_ARRVAL_P(files_zval);
+    count = zend_hash_num_elements(files);
+    array_init(return_value);
+    if (count == 0) {
+        return;
+    }
+
+    batch.sources = (const char **) ecalloc(count, sizeof(char *));
+    batch.results = (IplImage **) ecalloc(count, sizeof(IplImage *));
+    batch.mode = mode;
+
+    for (i = 0, zend_hash_internal_pointer_reset_ex(files, &pos);
+            zend_hash_get_current_data_ex(files, (void **) &entry, &pos) == SUCCESS;
+            zend_hash_move_forward_ex(files, &pos), i++) {
+        if (Z_TYPE_PP(entry) != IS_STRING) {
+            zend_throw_exception(opencv_ce_cvexception, "Files must be given as an array of filenames", 0 TSRMLS_CC);
+            goto cleanup;
+        }
+        php_opencv_basedir_check(Z_STRVAL_PP(entry) TSRMLS_CC);
+        if (EG(exception)) {
+            goto cleanup;
+        }
+        batch.sources[i] = Z_STRVAL_PP(entry);
+    }
+
+    php_opencv_parallel_run(count, php_opencv_thread_count(threads TSRMLS_CC), php_opencv_batch_load_task, &batch);
+
+    for (i = 0, zend_hash_internal_pointer_reset_ex(files, &pos);
+            zend_hash_get_current_data_ex(files, (void **) &entry, &pos) == SUCCESS;
+            zend_hash_move_forward_ex(files, &pos), i++) {
+        MAKE_STD_ZVAL(image_zval);
+        if (batch.results[i] != NULL) {
+            php_opencv_make_image_zval(batch.results[i], image_zval TSRMLS_CC);
+        } else {
+            ZVAL_FALSE(image_zval);
+        }
+        php_opencv_batch_add_result(return_value, files, &pos, image_zval);
+    }
+
+cleanup:
+    efree(batch.sources);
+    efree(batch.results);
+}
+/* }}} */
+
+/* {{{ proto array run(Pipeline pipeline, array images [, int threads])
+       Runs the pipeline over every image in parallel, keeping the array keys */
+PHP_METHOD(OpenCV_Batch, run)
+{
+    zval *pipeline_zval, *images_zval, **entry, *image_zval;
+    HashTable *images;
+    HashPosition pos;
+    opencv_pipeline_object *pipeline;
+    php_opencv_batch_pipeline batch;
+    long threads = 0;
+    int count, thread_count, i;
+    const char *error = NULL;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "Oa|l", &pipeline_zval, opencv_ce_pipeline, &images_zval, &threads) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    pipeline = (opencv_pipeline_object *) zend_object_store_get_object(pipeline_zval TSRMLS_CC);
+    if (pipeline->op_count == 0) {
+        zend_throw_exception(opencv_ce_cvexception, "The pipeline has no steps", 0 TSRMLS_CC);
+        return;
+    }
+
+    images = Z_ARRVAL_P(images_zval);
+    count = zend_hash_num_elements(images);
+    array_init(return_value);
+    if (count == 0) {
+        return;
+    }
+
+    for (zend_hash_internal_pointer_reset_ex(images, &pos);
+            zend_hash_get_current_data_ex(images, (void **) &entry, &pos) == SUCCESS;
+            zend_hash_move_forward_ex(images, &pos)) {
+        if (Z_TYPE_PP(entry) != IS_OBJECT || !instanceof_function(Z_OBJCE_PP(entry), opencv_ce_image TSRMLS_CC)) {
+            zend_throw_exception(opencv_ce_cvexception, "Images must be given as an array of OpenCV\\Image objects", 0 TSRMLS_CC);
+            return;
+        }
+    }
+
+    thread_count = php_opencv_thread_count(threads TSRMLS_CC);
+    batch.ops = pipeline->ops;
+    batch.op_count = pipeline->op_count;
+    batch.sources = (IplImage **) ecalloc(count, sizeof(IplImage *));
+    batch.results = (IplImage **) ecalloc(count, sizeof(IplImage *));
+    batch.buffers = (php_opencv_pipeline_buffers *) ecalloc(thread_count, sizeof(php_opencv_pipeline_buffers));
+    batch.errors = (char (*)[256]) ecalloc(thread_count, sizeof(*batch.errors));
+
+    for (i = 0, zend_hash_internal_pointer_reset_ex(images, &pos);
+            zend_hash_get_current_data_ex(images, (void **) &entry, &pos) == SUCCESS;
+            zend_hash_move_forward_ex(images, &pos), i++) {
+        batch.sources[i] = opencv_image_object_get(*entry TSRMLS_CC)->cvptr;
+    }
+
+    php_opencv_parallel_run(count, thread_count, php_opencv_batch_pipeline_task, &batch);
+
+    for (i = 0; i < thread_count; i++) {
+        if (error == NULL && batch.errors[i][0] != '\0') {
+            error = batch.errors[i];
+        }
+    }
+
+    if (error != NULL) {
+        zend_throw_exception(opencv_ce_cvexception, (char *) error, 0 TSRMLS_CC);
+        for (i = 0; i < count; i++) {
+            if (batch.results[i] != NULL) {
+                cvReleaseImage(&batch.results[i]);
+            }
+        }
+    } else {
+        for (i = 0, zend_hash_internal_pointer_reset_ex(images, &pos);
+                zend_hash_get_current_data_ex(images, (void **) &entry, &pos) == SUCCESS;
+                zend_hash_move_forward_ex(images, &pos), i++) {
+            MAKE_STD_ZVAL(image_zval);
+            php_opencv_make_image_zval(batch.results[i], image_zval TSRMLS_CC);
+            php_opencv_batch_add_result(return_value, images, &pos, image_zval);
+        }
+    }
+
+    for (i = 0; i < thread_count; i++) {
+        php_opencv_pipeline_buffers_free(&batch.buffers[i]);
+    }
+    efree(batch.buffers);
+    efree(batch.errors);
+    efree(batch.sources);
+    efree(batch.results);
+}
+/* }}} */
+
+/* {{{ opencv_batch_methods[] */
+const zend_function_entry opencv_batch_methods[] = {
+    PHP_ME(OpenCV_Batch, __construct, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
+    PHP_ME(OpenCV_Batch, resize, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Batch, load, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Batch, run, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    {NULL, NULL, NULL}
+};
+/* }}} */
+
+/* {{{ PHP_MINIT_FUNCTION */
+PHP_MINIT_FUNCTION(opencv_batch)
+{
+    zend_class_entry ce;
+
+    INIT_NS_CLASS_ENTRY(ce, "OpenCV", "Batch", opencv_batch_methods);
+    opencv_ce_batch = zend_register_internal_class(&ce TSRMLS_CC);
+
+    return SUCCESS;
+}
+/* }}} */
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
@@ -23,8 +23,192 @@
 #endif
 
 #include "php_opencv.h"
+#include "zend_interfaces.h"
+
+#include <pthread.h>
 
 zend_class_entry *opencv_ce_capture;
+zend_class_entry *opencv_ce_frameiterator;
+
+/* A bounded ring of frames filled by a decoding thread. The thread takes
+   capture_lock around every use of the CvCapture, so the PHP side takes it
+   too before touching the capture directly. The generation is bumped
+   whenever the ring is flushed (on a seek) so a frame decoded from the old
+   position is thrown away. */
+struct _php_opencv_prefetch {
+    CvCapture *capture;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_mutex_t capture_lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    IplImage **slots;
+    int size;
+    int head;
+    int count;
+    unsigned long generation;
+    zend_bool eof;
+    zend_bool stop;
+    IplImage *current;
+};
+
+/* Copies a frame into a ring slot, reusing the image already there if it
+   has the right shape */
+static void php_opencv_prefetch_store(IplImage **slot, IplImage *frame)
+{
+    if (*slot != NULL && ((*slot)->width != frame->width || (*slot)->height != frame->height
+            || (*slot)->depth != frame->depth || (*slot)->nChannels != frame->nChannels)) {
+        cvReleaseImage(slot);
+    }
+    if (*slot == NULL) {
+        *slot = cvCreateImage(cvGetSize(frame), frame->depth, frame->nChannels);
+    }
+    cvCopy(frame, *slot);
+    (*slot)->origin = frame->origin;
+}
+
+static void *php_opencv_prefetch_main(void *arg)
+{
+    php_opencv_prefetch *prefetch = (php_opencv_prefetch *) arg;
+    IplImage *frame;
+    unsigned long generation;
+    int tail;
+
+    for (;;) {
+        pthread_mutex_lock(&prefetch->lock);
+        while (!prefetch->stop && (prefetch->count == prefetch->size || prefetch->eof)) {
+            pthread_cond_wait(&prefetch->not_full, &prefetch->lock);
+        }
+        if (prefetch->stop) {
+            pthread_mutex_unlock(&prefetch->lock);
+            break;
+        }
+        pthread_mutex_unlock(&prefetch->lock);
+
+        /* Flushes happen under capture_lock, so the position can't move
+           between reading the generation and decoding the frame. Only this
+           thread fills free slots, so the decode and copy run without
+           holding the ring lock. */
+        pthread_mutex_lock(&prefetch->capture_lock);
+        pthread_mutex_lock(&prefetch->lock);
+        tail = (prefetch->head + prefetch->count) % prefetch->size;
+        generation = prefetch->generation;
+        pthread_mutex_unlock(&prefetch->lock);
+        try {
+            frame = cvQueryFrame(prefetch->capture);
+            if (frame != NULL) {
+                php_opencv_prefetch_store(&prefetch->slots[tail], frame);
+            }
+        } catch (cv::Exception &e) {
+            frame = NULL;
+        }
+        pthread_mutex_unlock(&prefetch->capture_lock);
+
+        pthread_mutex_lock(&prefetch->lock);
+        if (generation == prefetch->generation) {
+            if (frame != NULL) {
+                prefetch->count++;
+            } else {
+                prefetch->eof = 1;
+            }
+            pthread_cond_broadcast(&prefetch->not_empty);
+        }
+        pthread_mutex_unlock(&prefetch->lock);
+    }
+    return NULL;
+}
+
+static php_opencv_prefetch *php_opencv_prefetch_start(CvCapture *capture, int size)
+{
+    php_opencv_prefetch *prefetch = (php_opencv_prefetch *) calloc(1, sizeof(php_opencv_prefetch));
+
+    prefetch->capture = capture;
+    prefetch->size = size;
+    prefetch->slots = (IplImage **) calloc(size, sizeof(IplImage *));
+    pthread_mutex_init(&prefetch->lock, NULL);
+    pthread_mutex_init(&prefetch->capture_lock, NULL);
+    pthread_cond_init(&prefetch->not_empty, NULL);
+    pthread_cond_init(&prefetch->not_full, NULL);
+
+    if (pthread_create(&prefetch->thread, NULL, php_opencv_prefetch_main, prefetch) != 0) {
+        pthread_cond_destroy(&prefetch->not_full);
+        pthread_cond_destroy(&prefetch->not_empty);
+        pthread_mutex_destroy(&prefetch->capture_lock);
+        pthread_mutex_destroy(&prefetch->lock);
+        free(prefetch->slots);
+        free(prefetch);
+        return NULL;
+    }
+    return prefetch;
+}
+
+static void php_opencv_prefetch_stop(php_opencv_prefetch *prefetch)
+{
+    int i;
+
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->stop = 1;
+    pthread_cond_broadcast(&prefetch->not_full);
+    pthread_mutex_unlock(&prefetch->lock);
+    pthread_join(prefetch->thread, NULL);
+
+    for (i = 0; i < prefetch->size; i++) {
+        if (prefetch->slots[i] != NULL) {
+            cvReleaseImage(&prefetch->slots[i]);
+        }
+    }
+    if (prefetch->current != NULL) {
+        cvReleaseImage(&prefetch->current);
+    }
+    pthread_cond_destroy(&prefetch->not_full);
+    pthread_cond_destroy(&prefetch->not_empty);
+    pthread_mutex_destroy(&prefetch->capture_lock);
+    pthread_mutex_destroy(&prefetch->lock);
+    free(prefetch->slots);
+    free(prefetch);
+}
+
+/* Waits for the next decoded frame and makes it current, giving the buffer
+   of the previous current frame back to the ring. Returns NULL at the end
+   of the stream. */
+static IplImage *php_opencv_prefetch_grab(php_opencv_prefetch *prefetch)
+{
+    IplImage *frame;
+
+    pthread_mutex_lock(&prefetch->lock);
+    while (prefetch->count == 0 && !prefetch->eof) {
+        pthread_cond_wait(&prefetch->not_empty, &prefetch->lock);
+    }
+    if (prefetch->count == 0) {
+        /* Nothing is current past the end, so retrieveFrame fails too */
+        if (prefetch->current != NULL) {
+            cvReleaseImage(&prefetch->current);
+        }
+        pthread_mutex_unlock(&prefetch->lock);
+        return NULL;
+    }
+
+    frame = prefetch->slots[prefetch->head];
+    prefetch->slots[prefetch->head] = prefetch->current;
+    prefetch->current = frame;
+    prefetch->head = (prefetch->head + 1) % prefetch->size;
+    prefetch->count--;
+    pthread_cond_broadcast(&prefetch->not_full);
+    pthread_mutex_unlock(&prefetch->lock);
+
+    return frame;
+}
+
+/* Drops any buffered frames, e.g. after the position has changed */
+static void php_opencv_prefetch_flush(php_opencv_prefetch *prefetch)
+{
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->count = 0;
+    prefetch->eof = 0;
+    prefetch->generation++;
+    pthread_cond_broadcast(&prefetch->not_full);
+    pthread_mutex_unlock(&prefetch->lock);
+}
 
 PHP_OPENCV_API opencv_capture_object* opencv_capture_object_get(zval *zobj TSRMLS_DC) {
     opencv_capture_object *pobj = (opencv_capture_object *) zend_object_store_get_object(zobj TSRMLS_CC);
@@ -41,6 +225,9 @@ void opencv_capture_object_destroy(void *object TSRMLS_DC)
     zend_hash_destroy(capture->std.properties);
     FREE_HASHTABLE(capture->std.properties);
 
+    if (capture->prefetch != NULL) {
+        php_opencv_prefetch_stop(capture->prefetch);
+    }
     if(capture->cvptr != NULL){
         cvReleaseCapture(&capture->cvptr);
     }
@@ -57,6 +244,7 @@ PHP_OPENCV_API zend_object_value opencv_capture_object_new(zend_class_entry *ce
 
 	capture->std.ce = ce;
     capture->cvptr = NULL;
+    capture->prefetch = NULL;
 
     ALLOC_HASHTABLE(capture->std.properties);
     zend_hash_init(capture->std.properties, 0, NULL, ZVAL_PTR_DTOR, 0);
@@ -70,14 +258,31 @@ PHP_OPENCV_API zend_object_value opencv_capture_object_new(zend_class_entry *ce
     return retval;
 }
 
+/* Starts decoding ahead if the prefetch option asks for it */
+static void php_opencv_capture_init_prefetch(opencv_capture_object *capture_object, zval *options_zval TSRMLS_DC)
+{
+    long prefetch = php_opencv_option_long(options_zval, "prefetch", 0);
+
+    if (prefetch > 0 && capture_object->cvptr != NULL) {
+        capture_object->prefetch = php_opencv_prefetch_start(capture_object->cvptr, prefetch);
+        if (capture_object->prefetch == NULL) {
+            zend_throw_exception(opencv_ce_cvexception, "Could not start the prefetch thread", 0 TSRMLS_CC);
+        }
+    }
+}
+
+/* {{{ proto Capture createCameraCapture(int camera [, array options])
+       Set the "prefetch" option to decode up to that many frames ahead on a
+       background thread */
 PHP_METHOD(OpenCV_Capture, createCameraCapture)
 {
 	long camera;
 	opencv_capture_object *capture_object;
     CvCapture *temp;
+    zval *options_zval = NULL;
 
 	PHP_OPENCV_ERROR_HANDLING();
-	if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "l", &camera) == FAILURE)
+	if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "l|a", &camera, &options_zval) == FAILURE)
     {
 		PHP_OPENCV_RESTORE_ERRORS();
 		return;
@@ -88,20 +293,25 @@ PHP_METHOD(OpenCV_Capture, createCameraCapture)
     temp = (CvCapture *) cvCaptureFromCAM(camera);
     capture_object = (opencv_capture_object *) zend_object_store_get_object(return_value TSRMLS_CC);
     capture_object->cvptr = temp;
+    php_opencv_capture_init_prefetch(capture_object, options_zval TSRMLS_CC);
 
 	php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
 
+/* {{{ proto Capture createFileCapture(string filename [, array options])
+       Set the "prefetch" option to decode up to that many frames ahead on a
+       background thread */
 PHP_METHOD(OpenCV_Capture, createFileCapture)
 {
     const char *filename;
 	int filename_len;
 	opencv_capture_object *capture_object;
     CvCapture *temp;
+    zval *options_zval = NULL;
 
 	PHP_OPENCV_ERROR_HANDLING();
-	if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "s", &filename, &filename_len) == FAILURE)
+	if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "s|a", &filename, &filename_len, &options_zval) == FAILURE)
     {
 		PHP_OPENCV_RESTORE_ERRORS();
 		return;
@@ -122,10 +332,29 @@ PHP_METHOD(OpenCV_Capture, createFileCapture)
     }
 
     capture_object->cvptr = temp;
+    php_opencv_capture_init_prefetch(capture_object, options_zval TSRMLS_CC);
 	php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
 
+/* Moves on to the next frame, from the prefetch ring if there is one */
+static int php_opencv_capture_grab(opencv_capture_object *capture_object)
+{
+    if (capture_object->prefetch != NULL) {
+        return php_opencv_prefetch_grab(capture_object->prefetch) != NULL;
+    }
+    return cvGrabFrame(capture_object->cvptr);
+}
+
+/* Returns the current frame, which stays owned by the capture */
+static IplImage *php_opencv_capture_retrieve(opencv_capture_object *capture_object)
+{
+    if (capture_object->prefetch != NULL) {
+        return capture_object->prefetch->current;
+    }
+    return cvRetrieveFrame(capture_object->cvptr, 0);
+}
+
 PHP_METHOD(OpenCV_Capture, grabFrame)
 {
     zval *capture_zval;
@@ -140,53 +369,145 @@ PHP_METHOD(OpenCV_Capture, grabFrame)
     PHP_OPENCV_ERROR_HANDLING();
 
     capture_object = opencv_capture_object_get(getThis() TSRMLS_CC);
-    long result = cvGrabFrame(capture_object->cvptr);
+    long result = php_opencv_capture_grab(capture_object);
 
     php_opencv_throw_exception(TSRMLS_C);
     RETURN_LONG(result);
 }
 
+/* Hands a frame back to PHP. The capture owns the frame and reuses it on the
+   next grab, so it is either copied into the caller's image (no allocation)
+   or cloned into a new one. */
+static void php_opencv_capture_return_frame(IplImage *frame, zval *dst_zval, zval *return_value TSRMLS_DC)
+{
+    opencv_image_object *dst_object;
+
+    if (frame == NULL) {
+        RETURN_FALSE;
+    }
+
+    if (dst_zval == NULL) {
+        php_opencv_make_image_zval(php_opencv_image_clone(frame TSRMLS_CC), return_value TSRMLS_CC);
+        return;
+    }
+
+    dst_object = opencv_image_object_get(dst_zval TSRMLS_CC);
+    if (dst_object->cvptr->width != frame->width || dst_object->cvptr->height != frame->height
+            || dst_object->cvptr->depth != frame->depth || dst_object->cvptr->nChannels != frame->nChannels) {
+        zend_throw_exception(opencv_ce_cvexception, "The destination image must have the same size, depth and channels as the frame", 0 TSRMLS_CC);
+        return;
+    }
+
+    cvCopy(frame, dst_object->cvptr);
+    dst_object->cvptr->origin = frame->origin;
+    RETVAL_ZVAL(dst_zval, 1, 0);
+}
+
+/* Grabs the next frame and returns it. When prefetching, the frame is
+   copied out like any other so its buffer goes back to the ring on the next
+   grab, and the decoding thread never has to allocate once the ring is
+   full. */
+static void php_opencv_capture_query(opencv_capture_object *capture_object, zval *dst_zval, zval *return_value TSRMLS_DC)
+{
+    if (!php_opencv_capture_grab(capture_object)) {
+        RETURN_FALSE;
+    }
+
+    php_opencv_capture_return_frame(php_opencv_capture_retrieve(capture_object), dst_zval, return_value TSRMLS_CC);
+}
+
+/* {{{ proto Image retrieveFrame([Image dst])
+       Returns the grabbed frame, or false if there is none. Passing an image
+       of the same shape as the frames reuses it instead of allocating. */
 PHP_METHOD(OpenCV_Capture, retrieveFrame)
 {
-    zval *capture_zval;
+    zval *capture_zval, *dst_zval = NULL;
     opencv_capture_object *capture_object;
-    IplImage *temp;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O", &capture_zval, opencv_ce_capture) == FAILURE)
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O|O!", &capture_zval, opencv_ce_capture, &dst_zval, opencv_ce_image) == FAILURE)
     {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
-    PHP_OPENCV_ERROR_HANDLING();
+    PHP_OPENCV_RESTORE_ERRORS();
 
     capture_object = opencv_capture_object_get(getThis() TSRMLS_CC);
-    temp = cvCloneImage(cvRetrieveFrame(capture_object->cvptr, 0));
-    php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
+    php_opencv_capture_return_frame(php_opencv_capture_retrieve(capture_object), dst_zval, return_value TSRMLS_CC);
 
     php_opencv_throw_exception(TSRMLS_C);
 }
+/* }}} */
 
+/* {{{ proto Image queryFrame([Image dst])
+       Grabs and returns the next frame, or false at the end of the stream.
+       Passing an image of the same shape as the frames reuses it instead of
+       allocating. */
 PHP_METHOD(OpenCV_Capture, queryFrame)
 {
-    zval *capture_zval;
+    zval *capture_zval, *dst_zval = NULL;
     opencv_capture_object *capture_object;
-    IplImage *temp;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O", &capture_zval, opencv_ce_capture) == FAILURE)
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O|O!", &capture_zval, opencv_ce_capture, &dst_zval, opencv_ce_image) == FAILURE)
     {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
-    PHP_OPENCV_ERROR_HANDLING();
+    PHP_OPENCV_RESTORE_ERRORS();
 
     capture_object = opencv_capture_object_get(getThis() TSRMLS_CC);
-    temp = cvCloneImage(cvQueryFrame(capture_object->cvptr));
-    php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
+    php_opencv_capture_query(capture_object, dst_zval, return_value TSRMLS_CC);
 
     php_opencv_throw_exception(TSRMLS_C);
 }
+/* }}} */
+
+/* Reads a property, allowing for any frames decoded ahead but not yet
+   handed out */
+static double php_opencv_capture_get_property(opencv_capture_object *capture_object, long property)
+{
+    php_opencv_prefetch *prefetch = capture_object->prefetch;
+    double val, fps;
+
+    if (prefetch == NULL) {
+        return cvGetCaptureProperty(capture_object->cvptr, property);
+    }
+
+    pthread_mutex_lock(&prefetch->capture_lock);
+    val = cvGetCaptureProperty(capture_object->cvptr, property);
+    pthread_mutex_lock(&prefetch->lock);
+    if (property == CV_CAP_PROP_POS_FRAMES) {
+        val -= prefetch->count;
+    } else if (property == CV_CAP_PROP_POS_MSEC && prefetch->count > 0) {
+        fps = cvGetCaptureProperty(capture_object->cvptr, CV_CAP_PROP_FPS);
+        if (fps > 0) {
+            val -= prefetch->count * 1000.0 / fps;
+        }
+    }
+    pthread_mutex_unlock(&prefetch->lock);
+    pthread_mutex_unlock(&prefetch->capture_lock);
+
+    return val;
+}
+
+/* Sets a property. Buffered frames came from before the change, so they
+   are dropped. */
+static double php_opencv_capture_set_property(opencv_capture_object *capture_object, long property, double val)
+{
+    php_opencv_prefetch *prefetch = capture_object->prefetch;
+
+    if (prefetch == NULL) {
+        return cvSetCaptureProperty(capture_object->cvptr, property, val);
+    }
+
+    pthread_mutex_lock(&prefetch->capture_lock);
+    php_opencv_prefetch_flush(prefetch);
+    val = cvSetCaptureProperty(capture_object->cvptr, property, val);
+    pthread_mutex_unlock(&prefetch->capture_lock);
+
+    return val;
+}
 
 PHP_METHOD(OpenCV_Capture, getProperty)
 {
@@ -205,7 +526,7 @@ PHP_METHOD(OpenCV_Capture, getProperty)
     PHP_OPENCV_ERROR_HANDLING();
 
     capture_object = opencv_capture_object_get(getThis() TSRMLS_CC);
-    val = cvGetCaptureProperty(capture_object->cvptr, property);
+    val = php_opencv_capture_get_property(capture_object, property);
     php_opencv_throw_exception(TSRMLS_C);
 
     /* FourCC is special */
@@ -233,10 +554,74 @@ PHP_METHOD(OpenCV_Capture, setProperty)
     PHP_OPENCV_ERROR_HANDLING();
 
     capture_object = opencv_capture_object_get(getThis() TSRMLS_CC);
-    val = cvSetCaptureProperty(capture_object->cvptr, property, val);
+    val = php_opencv_capture_set_property(capture_object, property, val);
     php_opencv_throw_exception(TSRMLS_C);
 }
 
+/* {{{ proto FrameIterator frames([int step [, float startMsec [, float endMsec [, bool seek]]]])
+       Iterates over every step-th frame between startMsec and endMsec,
+       keyed by frame number. Frames in between are grabbed but never
+       decoded into an Image; with seek they are skipped by setting the
+       frame position instead, which is faster on files with frequent
+       keyframes. */
+PHP_METHOD(OpenCV_Capture, frames)
+{
+    zval *capture_zval;
+    opencv_frame_iterator_object *iterator_object;
+    long step = 1;
+    double start_msec = -1, end_msec = -1;
+    zend_bool seek = 0;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O|lddb", &capture_zval, opencv_ce_capture, &step, &start_msec, &end_msec, &seek) == FAILURE)
+    {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    if (step < 1) {
+        zend_throw_exception(opencv_ce_cvexception, "The step must be at least 1", 0 TSRMLS_CC);
+        return;
+    }
+
+    opencv_capture_object_get(capture_zval TSRMLS_CC);
+
+    object_init_ex(return_value, opencv_ce_frameiterator);
+    iterator_object = (opencv_frame_iterator_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    iterator_object->capture = capture_zval;
+    Z_ADDREF_P(capture_zval);
+    iterator_object->step = step;
+    iterator_object->start_msec = start_msec;
+    iterator_object->end_msec = end_msec;
+    iterator_object->seek = seek;
+}
+/* }}} */
+
+/* {{{ proto FrameIterator getIterator()
+       Iterates over every frame, so a capture can be used with foreach */
+PHP_METHOD(OpenCV_Capture, getIterator)
+{
+    zval *capture_zval;
+    opencv_frame_iterator_object *iterator_object;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O", &capture_zval, opencv_ce_capture) == FAILURE)
+    {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    opencv_capture_object_get(capture_zval TSRMLS_CC);
+
+    object_init_ex(return_value, opencv_ce_frameiterator);
+    iterator_object = (opencv_frame_iterator_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    iterator_object->capture = capture_zval;
+    Z_ADDREF_P(capture_zval);
+}
+/* }}} */
+
 /* {{{ opencv_capture_methods[] */
 const zend_function_entry opencv_capture_methods[] = {
     PHP_ME(OpenCV_Capture, createCameraCapture, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
@@ -246,6 +631,229 @@ const zend_function_entry opencv_capture_methods[] = {
     PHP_ME(OpenCV_Capture, queryFrame, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(OpenCV_Capture, getProperty, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(OpenCV_Capture, setProperty, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Capture, frames, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Capture, getIterator, NULL, ZEND_ACC_PUBLIC)
+    {NULL, NULL, NULL}
+};
+/* }}} */
+
+void opencv_frame_iterator_object_destroy(void *object TSRMLS_DC)
+{
+    opencv_frame_iterator_object *iterator = (opencv_frame_iterator_object *)object;
+
+    zend_hash_destroy(iterator->std.properties);
+    FREE_HASHTABLE(iterator->std.properties);
+
+    if (iterator->current != NULL) {
+        zval_ptr_dtor(&iterator->current);
+    }
+    if (iterator->capture != NULL) {
+        zval_ptr_dtor(&iterator->capture);
+    }
+    efree(iterator);
+}
+
+static zend_object_value opencv_frame_iterator_object_new(zend_class_entry *ce TSRMLS_DC)
+{
+    zend_object_value retval;
+    opencv_frame_iterator_object *iterator;
+    zval *temp;
+
+    iterator = (opencv_frame_iterator_object *) ecalloc(1, sizeof(opencv_frame_iterator_object));
+
+    iterator->std.ce = ce;
+    iterator->step = 1;
+    iterator->start_msec = -1;
+    iterator->end_msec = -1;
+
+    ALLOC_HASHTABLE(iterator->std.properties);
+    zend_hash_init(iterator->std.properties, 0, NULL, ZVAL_PTR_DTOR, 0);
+#if PHP_VERSION_ID < 50399
+    zend_hash_copy(iterator->std.properties, &ce->default_properties, (copy_ctor_func_t) zval_add_ref,(void *) &temp, sizeof(zval *));
+#else
+    object_properties_init(&iterator->std, ce);
+#endif
+    retval.handle = zend_objects_store_put(iterator, NULL, (zend_objects_free_object_storage_t)opencv_frame_iterator_object_destroy, NULL TSRMLS_CC);
+    retval.handlers = zend_get_std_object_handlers();
+    return retval;
+}
+
+static opencv_frame_iterator_object *opencv_frame_iterator_object_get(zval *zobj TSRMLS_DC)
+{
+    opencv_frame_iterator_object *pobj = (opencv_frame_iterator_object *) zend_object_store_get_object(zobj TSRMLS_CC);
+    if (pobj->capture == NULL) {
+        zend_throw_exception(opencv_ce_cvexception, "OpenCV\\FrameIterator must be created with Capture::frames()", 0 TSRMLS_CC);
+        return NULL;
+    }
+    return pobj;
+}
+
+/* Skips the given number of frames without decoding them into Images, then
+   reads the next one. Leaves current as NULL at the end of the stream or
+   once the time range is over. */
+static void php_opencv_frame_iterator_fetch(opencv_frame_iterator_object *iterator, long skip TSRMLS_DC)
+{
+    opencv_capture_object *capture_object = opencv_capture_object_get(iterator->capture TSRMLS_CC);
+    zval *frame;
+    long i;
+
+    if (iterator->current != NULL) {
+        zval_ptr_dtor(&iterator->current);
+        iterator->current = NULL;
+    }
+
+    if (skip > 0) {
+        if (iterator->seek) {
+            php_opencv_capture_set_property(capture_object, CV_CAP_PROP_POS_FRAMES, iterator->next_frame + skip);
+        } else {
+            for (i = 0; i < skip; i++) {
+                if (!php_opencv_capture_grab(capture_object)) {
+                    return;
+                }
+            }
+        }
+        iterator->next_frame += skip;
+    }
+
+    /* The position is read before decoding: afterwards some backends report
+       the time of the frame after this one */
+    if (iterator->end_msec >= 0 && php_opencv_capture_get_property(capture_object, CV_CAP_PROP_POS_MSEC) > iterator->end_msec) {
+        return;
+    }
+
+    MAKE_STD_ZVAL(frame);
+    php_opencv_capture_query(capture_object, NULL, frame TSRMLS_CC);
+    if (Z_TYPE_P(frame) != IS_OBJECT) {
+        zval_ptr_dtor(&frame);
+        return;
+    }
+
+    iterator->current = frame;
+    iterator->key = iterator->next_frame++;
+}
+
+/* {{{ proto void __construct()
+   Frame iterators are created with Capture::frames() */
+PHP_METHOD(OpenCV_FrameIterator, __construct)
+{
+    zend_throw_exception(opencv_ce_cvexception, "OpenCV\\FrameIterator must be created with Capture::frames()", 0 TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto void rewind()
+       Seeks to the start time if there is one, or back to the first frame
+       if the iterator has already been used, and reads the first frame */
+PHP_METHOD(OpenCV_FrameIterator, rewind)
+{
+    opencv_frame_iterator_object *iterator_object;
+    opencv_capture_object *capture_object;
+    double position;
+
+    if (zend_parse_parameters_none() == FAILURE) {
+        return;
+    }
+
+    iterator_object = opencv_frame_iterator_object_get(getThis() TSRMLS_CC);
+    if (iterator_object == NULL) {
+        return;
+    }
+    capture_object = opencv_capture_object_get(iterator_object->capture TSRMLS_CC);
+
+    if (iterator_object->start_msec >= 0) {
+        php_opencv_capture_set_property(capture_object, CV_CAP_PROP_POS_MSEC, iterator_object->start_msec);
+    } else if (iterator_object->started) {
+        php_opencv_capture_set_property(capture_object, CV_CAP_PROP_POS_FRAMES, 0);
+    }
+    iterator_object->started = 1;
+
+    /* Cameras don't report a position, so count from zero */
+    position = php_opencv_capture_get_property(capture_object, CV_CAP_PROP_POS_FRAMES);
+    iterator_object->next_frame = position > 0 ? (long) position : 0;
+
+    php_opencv_frame_iterator_fetch(iterator_object, 0 TSRMLS_CC);
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* {{{ proto bool valid() */
+PHP_METHOD(OpenCV_FrameIterator, valid)
+{
+    opencv_frame_iterator_object *iterator_object;
+
+    if (zend_parse_parameters_none() == FAILURE) {
+        return;
+    }
+
+    iterator_object = opencv_frame_iterator_object_get(getThis() TSRMLS_CC);
+    if (iterator_object == NULL) {
+        return;
+    }
+    RETURN_BOOL(iterator_object->current != NULL);
+}
+/* }}} */
+
+/* {{{ proto Image current() */
+PHP_METHOD(OpenCV_FrameIterator, current)
+{
+    opencv_frame_iterator_object *iterator_object;
+
+    if (zend_parse_parameters_none() == FAILURE) {
+        return;
+    }
+
+    iterator_object = opencv_frame_iterator_object_get(getThis() TSRMLS_CC);
+    if (iterator_object == NULL || iterator_object->current == NULL) {
+        return;
+    }
+    RETURN_ZVAL(iterator_object->current, 1, 0);
+}
+/* }}} */
+
+/* {{{ proto int key()
+       Returns the frame number of the current frame */
+PHP_METHOD(OpenCV_FrameIterator, key)
+{
+    opencv_frame_iterator_object *iterator_object;
+
+    if (zend_parse_parameters_none() == FAILURE) {
+        return;
+    }
+
+    iterator_object = opencv_frame_iterator_object_get(getThis() TSRMLS_CC);
+    if (iterator_object == NULL || iterator_object->current == NULL) {
+        return;
+    }
+    RETURN_LONG(iterator_object->key);
+}
+/* }}} */
+
+/* {{{ proto void next() */
+PHP_METHOD(OpenCV_FrameIterator, next)
+{
+    opencv_frame_iterator_object *iterator_object;
+
+    if (zend_parse_parameters_none() == FAILURE) {
+        return;
+    }
+
+    iterator_object = opencv_frame_iterator_object_get(getThis() TSRMLS_CC);
+    if (iterator_object == NULL || iterator_object->current == NULL) {
+        return;
+    }
+
+    php_opencv_frame_iterator_fetch(iterator_object, iterator_object->step - 1 TSRMLS_CC);
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* {{{ opencv_frame_iterator_methods[] */
+const zend_function_entry opencv_frame_iterator_methods[] = {
+    PHP_ME(OpenCV_FrameIterator, __construct, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
+    PHP_ME(OpenCV_FrameIterator, rewind, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_FrameIterator, valid, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_FrameIterator, current, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_FrameIterator, key, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_FrameIterator, next, NULL, ZEND_ACC_PUBLIC)
     {NULL, NULL, NULL}
 };
 /* }}} */
@@ -257,6 +865,14 @@ PHP_MINIT_FUNCTION(opencv_capture)
 
 	INIT_NS_CLASS_ENTRY(ce, "OpenCV", "Capture", opencv_capture_methods);
 	opencv_ce_capture = zend_register_internal_class(&ce TSRMLS_CC);
+	opencv_ce_capture->create_object = opencv_capture_object_new;
+	zend_class_implements(opencv_ce_capture TSRMLS_CC, 1, zend_ce_aggregate);
+
+	INIT_NS_CLASS_ENTRY(ce, "OpenCV", "FrameIterator", opencv_frame_iterator_methods);
+	opencv_ce_frameiterator = zend_register_internal_class(&ce TSRMLS_CC);
+	opencv_ce_frameiterator->create_object = opencv_frame_iterator_object_new;
+	opencv_ce_frameiterator->ce_flags |= ZEND_ACC_FINAL_CLASS;
+	zend_class_implements(opencv_ce_frameiterator TSRMLS_CC, 1, zend_ce_iterator);
 
     #define REGISTER_CAPTURE_LONG_CONST(const_name, value) \
 	zend_declare_class_constant_long(opencv_ce_capture, const_name, sizeof(const_name)-1, (long)value TSRMLS_CC); \
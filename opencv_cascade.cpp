@@ -0,0 +1,444 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 5                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2010 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Author: Michael Maclean <mgdm@php.net>                               |
+  +----------------------------------------------------------------------+
+*/
+
+/* $Id$ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php_opencv.h"
+
+zend_class_entry *opencv_ce_cascade;
+
+struct _php_opencv_cascade_entry {
+    char *path;
+    time_t mtime;
+    CvHaarClassifierCascade *cascade;
+    int refcount;
+    zend_bool cached;
+    unsigned long last_used;
+#ifdef ZTS
+    MUTEX_T detect_lock;
+#endif
+};
+
+/* The cascade cache lives for the lifetime of the worker process, so
+   repeated detections only pay for parsing the XML once. Entries are keyed
+   on the real path and mtime of the file, and the least recently used entry
+   is evicted once opencv.cascade_cache_size is reached. */
+static php_opencv_cascade_entry **opencv_cascade_cache = NULL;
+static int opencv_cascade_cache_count = 0;
+static int opencv_cascade_cache_capacity = 0;
+static unsigned long opencv_cascade_cache_clock = 0;
+#ifdef ZTS
+static MUTEX_T opencv_cascade_cache_lock;
+#define PHP_OPENCV_CASCADE_LOCK() tsrm_mutex_lock(opencv_cascade_cache_lock)
+#define PHP_OPENCV_CASCADE_UNLOCK() tsrm_mutex_unlock(opencv_cascade_cache_lock)
+#else
+#define PHP_OPENCV_CASCADE_LOCK()
+#define PHP_OPENCV_CASCADE_UNLOCK()
+#endif
+
+/* Must be called with the cache lock held */
+static void php_opencv_cascade_entry_unref(php_opencv_cascade_entry *entry)
+{
+    if (--entry->refcount > 0) {
+        return;
+    }
+
+    if (entry->cascade != NULL) {
+        cvReleaseHaarClassifierCascade(&entry->cascade);
+    }
+#ifdef ZTS
+    tsrm_mutex_free(entry->detect_lock);
+#endif
+    pefree(entry->path, 1);
+    pefree(entry, 1);
+}
+
+/* Must be called with the cache lock held */
+static void php_opencv_cascade_cache_evict(int index)
+{
+    php_opencv_cascade_entry *entry = opencv_cascade_cache[index];
+
+    opencv_cascade_cache[index] = opencv_cascade_cache[--opencv_cascade_cache_count];
+    opencv_cascade_cache[opencv_cascade_cache_count] = NULL;
+    entry->cached = 0;
+    php_opencv_cascade_entry_unref(entry);
+}
+
+/* {{{ php_opencv_cascade_acquire
+   Returns a referenced cascade for the given file, loading it if it is not
+   already cached. Throws and returns NULL on failure. */
+PHP_OPENCV_API php_opencv_cascade_entry *php_opencv_cascade_acquire(const char *filename TSRMLS_DC)
+{
+    char resolved_path[MAXPATHLEN];
+    struct stat sb;
+    php_opencv_cascade_entry *entry = NULL;
+    CvHaarClassifierCascade *cascade;
+    int i, lru = -1;
+
+    php_opencv_basedir_check(filename TSRMLS_CC);
+    if (EG(exception)) {
+        return NULL;
+    }
+
+    if (!VCWD_REALPATH(filename, resolved_path) || VCWD_STAT(resolved_path, &sb) != 0) {
+        zend_throw_exception(opencv_ce_cvexception, "Could not open the cascade file - check it exists", 0 TSRMLS_CC);
+        return NULL;
+    }
+
+    PHP_OPENCV_CASCADE_LOCK();
+    for (i = 0; i < opencv_cascade_cache_count; i++) {
+        if (strcmp(opencv_cascade_cache[i]->path, resolved_path) != 0) {
+            continue;
+        }
+
+        if (opencv_cascade_cache[i]->mtime == sb.st_mtime) {
+            entry = opencv_cascade_cache[i];
+            entry->refcount++;
+            entry->last_used = ++opencv_cascade_cache_clock;
+            PHP_OPENCV_CASCADE_UNLOCK();
+            return entry;
+        }
+
+        /* The file changed on disk, drop the stale copy */
+        php_opencv_cascade_cache_evict(i);
+        break;
+    }
+
+    /* Files that aren't OpenCV storage at all make cvLoad throw */
+    try {
+        cascade = (CvHaarClassifierCascade *) cvLoad(resolved_path, 0, 0, 0);
+    } catch (cv::Exception &e) {
+        cascade = NULL;
+    }
+    if (cascade == NULL || !CV_IS_HAAR_CLASSIFIER(cascade)) {
+        if (cascade != NULL) {
+            cvRelease((void **) &cascade);
+        }
+        PHP_OPENCV_CASCADE_UNLOCK();
+        cvSetErrStatus(CV_StsOk);
+        zend_throw_exception(opencv_ce_cvexception, "Could not load the Haar cascade - check it is a valid classifier file", 0 TSRMLS_CC);
+        return NULL;
+    }
+
+    entry = (php_opencv_cascade_entry *) pecalloc(1, sizeof(php_opencv_cascade_entry), 1);
+    entry->path = pestrdup(resolved_path, 1);
+    entry->mtime = sb.st_mtime;
+    entry->cascade = cascade;
+    entry->refcount = 1;
+    entry->last_used = ++opencv_cascade_cache_clock;
+#ifdef ZTS
+    entry->detect_lock = tsrm_mutex_alloc();
+#endif
+
+    if (opencv_cascade_cache_capacity > 0) {
+        if (opencv_cascade_cache_count == opencv_cascade_cache_capacity) {
+            for (i = 0; i < opencv_cascade_cache_count; i++) {
+                if (lru < 0 || opencv_cascade_cache[i]->last_used < opencv_cascade_cache[lru]->last_used) {
+                    lru = i;
+                }
+            }
+            php_opencv_cascade_cache_evict(lru);
+        }
+        entry->cached = 1;
+        entry->refcount++;
+        opencv_cascade_cache[opencv_cascade_cache_count++] = entry;
+    }
+    PHP_OPENCV_CASCADE_UNLOCK();
+
+    return entry;
+}
+/* }}} */
+
+/* {{{ php_opencv_cascade_release */
+PHP_OPENCV_API void php_opencv_cascade_release(php_opencv_cascade_entry *entry)
+{
+    PHP_OPENCV_CASCADE_LOCK();
+    php_opencv_cascade_entry_unref(entry);
+    PHP_OPENCV_CASCADE_UNLOCK();
+}
+/* }}} */
+
+/* {{{ php_opencv_cascade_cache_count */
+PHP_OPENCV_API int php_opencv_cascade_cache_count(void)
+{
+    return opencv_cascade_cache_count;
+}
+/* }}} */
+
+/* {{{ php_opencv_haar_params_init
+   Fills in detection parameters from an options array, keeping the old
+   defaults for anything not given */
+PHP_OPENCV_API void php_opencv_haar_params_init(php_opencv_haar_params *params, zval *options_zval TSRMLS_DC)
+{
+    zval *equalize;
+
+    params->scale_factor = php_opencv_option_double(options_zval, "scaleFactor", 1.1);
+    params->min_neighbors = php_opencv_option_long(options_zval, "minNeighbors", 3);
+    params->flags = php_opencv_option_long(options_zval, "flags", 0);
+    params->min_size = php_opencv_option_size(options_zval, "minSize", cvSize(20, 20));
+    params->max_size = php_opencv_option_size(options_zval, "maxSize", cvSize(0, 0));
+
+    equalize = php_opencv_option_find(options_zval, "equalize");
+    params->equalize = equalize != NULL ? zend_is_true(equalize) : 1;
+
+    if (params->scale_factor <= 1.0) {
+        zend_throw_exception(opencv_ce_cvexception, "The scale factor must be greater than 1", 0 TSRMLS_CC);
+    } else if (params->min_neighbors < 0) {
+        zend_throw_exception(opencv_ce_cvexception, "minNeighbors must not be negative", 0 TSRMLS_CC);
+    } else if (params->flags & ~(CV_HAAR_DO_CANNY_PRUNING | CV_HAAR_SCALE_IMAGE | CV_HAAR_FIND_BIGGEST_OBJECT | CV_HAAR_DO_ROUGH_SEARCH)) {
+        zend_throw_exception(opencv_ce_cvexception, "The flags must be a combination of the HAAR_* constants", 0 TSRMLS_CC);
+    } else if (params->min_size.width < 0 || params->min_size.height < 0 || params->max_size.width < 0 || params->max_size.height < 0) {
+        zend_throw_exception(opencv_ce_cvexception, "minSize and maxSize must not be negative", 0 TSRMLS_CC);
+    } else if ((params->max_size.width > 0 || params->max_size.height > 0)
+            && (params->max_size.width < params->min_size.width || params->max_size.height < params->min_size.height)) {
+        zend_throw_exception(opencv_ce_cvexception, "maxSize must not be smaller than minSize", 0 TSRMLS_CC);
+    }
+}
+/* }}} */
+
+/* {{{ php_opencv_haar_detect
+   Runs the cascade over the image and fills return_value with an array of
+   rectangles. The image itself is never modified. */
+PHP_OPENCV_API void php_opencv_haar_detect(IplImage *image, php_opencv_cascade_entry *entry, const php_opencv_haar_params *params, zval *return_value TSRMLS_DC)
+{
+    IplImage *grey_image;
+    CvMemStorage *storage;
+    CvSeq *objects;
+    int i;
+
+    if (image->nChannels > 1) {
+        grey_image = php_opencv_image_create(cvGetSize(image), IPL_DEPTH_8U, 1 TSRMLS_CC);
+        cvCvtColor(image, grey_image, CV_BGR2GRAY);
+    } else if (params->equalize) {
+        grey_image = php_opencv_image_create(cvGetSize(image), IPL_DEPTH_8U, 1 TSRMLS_CC);
+        cvCopy(image, grey_image);
+    } else {
+        grey_image = image;
+    }
+    if (params->equalize) {
+        cvEqualizeHist(grey_image, grey_image);
+    }
+
+    /* Each worker keeps one storage block and clears it after every run,
+       rather than allocating a new one per detection */
+    if (OPENCV_G(haar_storage) == NULL) {
+        OPENCV_G(haar_storage) = cvCreateMemStorage(0);
+    }
+    storage = OPENCV_G(haar_storage);
+
+    /* The cascade keeps per-scale state while it runs, so it can't be
+       shared between concurrent detections */
+#ifdef ZTS
+    tsrm_mutex_lock(entry->detect_lock);
+#endif
+    #if ( (CV_MAJOR_VERSION >= 2) && (CV_MINOR_VERSION >= 3) )
+    objects = cvHaarDetectObjects(grey_image, entry->cascade, storage, params->scale_factor, params->min_neighbors, params->flags, params->min_size, params->max_size);
+    #else
+    objects = cvHaarDetectObjects(grey_image, entry->cascade, storage, params->scale_factor, params->min_neighbors, params->flags, params->min_size);
+    #endif
+#ifdef ZTS
+    tsrm_mutex_unlock(entry->detect_lock);
+#endif
+
+    array_init(return_value);
+    for (i = 0; i < (objects ? objects->total : 0); i++) {
+        zval *temp;
+        CvRect *r = (CvRect *) cvGetSeqElem(objects, i);
+
+        MAKE_STD_ZVAL(temp);
+        array_init(temp);
+        add_assoc_long(temp, "x", r->x);
+        add_assoc_long(temp, "y", r->y);
+        add_assoc_long(temp, "width", r->width);
+        add_assoc_long(temp, "height", r->height);
+
+        add_next_index_zval(return_value, temp);
+    }
+
+    cvClearMemStorage(storage);
+    if (grey_image != image) {
+        php_opencv_image_release(&grey_image TSRMLS_CC);
+    }
+}
+/* }}} */
+
+void opencv_cascade_object_destroy(void *object TSRMLS_DC)
+{
+    opencv_cascade_object *cascade = (opencv_cascade_object *)object;
+
+    zend_hash_destroy(cascade->std.properties);
+    FREE_HASHTABLE(cascade->std.properties);
+
+    if (cascade->entry != NULL) {
+        php_opencv_cascade_release(cascade->entry);
+    }
+    efree(cascade);
+}
+
+static zend_object_value opencv_cascade_object_new(zend_class_entry *ce TSRMLS_DC)
+{
+    zend_object_value retval;
+    opencv_cascade_object *cascade;
+    zval *temp;
+
+    cascade = (opencv_cascade_object *) ecalloc(1, sizeof(opencv_cascade_object));
+
+    cascade->std.ce = ce;
+    cascade->entry = NULL;
+
+    ALLOC_HASHTABLE(cascade->std.properties);
+    zend_hash_init(cascade->std.properties, 0, NULL, ZVAL_PTR_DTOR, 0);
+#if PHP_VERSION_ID < 50399
+    zend_hash_copy(cascade->std.properties, &ce->default_properties, (copy_ctor_func_t) zval_add_ref,(void *) &temp, sizeof(zval *));
+#else
+    object_properties_init(&cascade->std, ce);
+#endif
+    retval.handle = zend_objects_store_put(cascade, NULL, (zend_objects_free_object_storage_t)opencv_cascade_object_destroy, NULL TSRMLS_CC);
+    retval.handlers = zend_get_std_object_handlers();
+    return retval;
+}
+
+static inline opencv_cascade_object* opencv_cascade_object_get(zval *zobj TSRMLS_DC) {
+    opencv_cascade_object *pobj = (opencv_cascade_object *) zend_object_store_get_object(zobj TSRMLS_CC);
+    if (pobj->entry == NULL) {
+        php_error(E_ERROR, "Internal cascade object missing in %s wrapper, you must call parent::__construct in extended classes", Z_OBJCE_P(zobj)->name);
+    }
+    return pobj;
+}
+
+/* {{{ proto void __construct(string filename)
+       Loads a Haar cascade, or picks it up from the worker's cascade cache */
+PHP_METHOD(OpenCV_CascadeClassifier, __construct)
+{
+    char *filename;
+    int filename_len;
+    opencv_cascade_object *cascade_object;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "s", &filename, &filename_len) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    cascade_object = (opencv_cascade_object *) zend_object_store_get_object(getThis() TSRMLS_CC);
+    cascade_object->entry = php_opencv_cascade_acquire(filename TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto array detectMultiScale(Image image [, array options])
+       Returns the rectangles of any objects found in the image. Options are
+       "scaleFactor" (default 1.1), "minNeighbors" (default 3), "flags" (the
+       HAAR_* constants), "minSize" (default 20), "maxSize" (default none),
+       given as a number or array(width, height), and "equalize" (default
+       true) to equalise the histogram of a copy of the image first. */
+PHP_METHOD(OpenCV_CascadeClassifier, detectMultiScale)
+{
+    opencv_cascade_object *cascade_object;
+    opencv_image_object *image_object;
+    zval *cascade_zval, *image_zval, *options_zval = NULL;
+    php_opencv_haar_params params;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "OO|a", &cascade_zval, opencv_ce_cascade, &image_zval, opencv_ce_image, &options_zval) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    cascade_object = opencv_cascade_object_get(cascade_zval TSRMLS_CC);
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+
+    php_opencv_haar_params_init(&params, options_zval TSRMLS_CC);
+    if (EG(exception)) {
+        return;
+    }
+
+    php_opencv_haar_detect(image_object->cvptr, cascade_object->entry, &params, return_value TSRMLS_CC);
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* {{{ opencv_cascade_methods[] */
+const zend_function_entry opencv_cascade_methods[] = {
+    PHP_ME(OpenCV_CascadeClassifier, __construct, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
+    PHP_ME(OpenCV_CascadeClassifier, detectMultiScale, NULL, ZEND_ACC_PUBLIC)
+    {NULL, NULL, NULL}
+};
+/* }}} */
+
+/* {{{ PHP_MINIT_FUNCTION */
+PHP_MINIT_FUNCTION(opencv_cascade)
+{
+    zend_class_entry ce;
+
+    INIT_NS_CLASS_ENTRY(ce, "OpenCV", "CascadeClassifier", opencv_cascade_methods);
+    opencv_ce_cascade = zend_register_internal_class(&ce TSRMLS_CC);
+    opencv_ce_cascade->create_object = opencv_cascade_object_new;
+
+    #define REGISTER_CASCADE_LONG_CONST(const_name, value) \
+    zend_declare_class_constant_long(opencv_ce_cascade, const_name, sizeof(const_name)-1, (long)value TSRMLS_CC); \
+    REGISTER_LONG_CONSTANT(#value,  value,  CONST_CS | CONST_PERSISTENT);
+
+    REGISTER_CASCADE_LONG_CONST("HAAR_DO_CANNY_PRUNING", CV_HAAR_DO_CANNY_PRUNING);
+    REGISTER_CASCADE_LONG_CONST("HAAR_SCALE_IMAGE", CV_HAAR_SCALE_IMAGE);
+    REGISTER_CASCADE_LONG_CONST("HAAR_FIND_BIGGEST_OBJECT", CV_HAAR_FIND_BIGGEST_OBJECT);
+    REGISTER_CASCADE_LONG_CONST("HAAR_DO_ROUGH_SEARCH", CV_HAAR_DO_ROUGH_SEARCH);
+
+    opencv_cascade_cache_capacity = OPENCV_G(cascade_cache_size) > 0 ? OPENCV_G(cascade_cache_size) : 0;
+    if (opencv_cascade_cache_capacity > 0) {
+        opencv_cascade_cache = (php_opencv_cascade_entry **) pecalloc(opencv_cascade_cache_capacity, sizeof(php_opencv_cascade_entry *), 1);
+    }
+#ifdef ZTS
+    opencv_cascade_cache_lock = tsrm_mutex_alloc();
+#endif
+
+    return SUCCESS;
+}
+/* }}} */
+
+/* {{{ PHP_MSHUTDOWN_FUNCTION */
+PHP_MSHUTDOWN_FUNCTION(opencv_cascade)
+{
+    while (opencv_cascade_cache_count > 0) {
+        php_opencv_cascade_cache_evict(opencv_cascade_cache_count - 1);
+    }
+    if (opencv_cascade_cache != NULL) {
+        pefree(opencv_cascade_cache, 1);
+        opencv_cascade_cache = NULL;
+    }
+#ifdef ZTS
+    tsrm_mutex_free(opencv_cascade_cache_lock);
+#endif
+
+    return SUCCESS;
+}
+/* }}} */
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
@@ -53,6 +53,12 @@ PHP_OPENCV_API void php_opencv_throw_exception(TSRMLS_D)
 	return;
 }
 
+/* The C++ API reports errors by throwing rather than through cvGetErrStatus */
+PHP_OPENCV_API void php_opencv_throw_cv_exception(const cv::Exception &e TSRMLS_DC)
+{
+	zend_throw_exception(opencv_ce_cvexception, (char *) e.err.c_str(), e.code TSRMLS_CC);
+}
+
 /*
  * Local variables:
  * tab-width: 4
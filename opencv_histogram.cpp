@@ -70,58 +70,428 @@ PHP_OPENCV_API zend_object_value opencv_histogram_object_new(zend_class_entry *c
     return retval;
 }
 
+/* Reads a number from a PHP array entry */
+static double php_opencv_histogram_number(zval **entry)
+{
+    zval tmp = **entry;
+
+    zval_copy_ctor(&tmp);
+    convert_to_double(&tmp);
+    return Z_DVAL(tmp);
+}
+
+/* Reads the constructor's ranges into ranges[], pointing into storage.
+   Uniform histograms take array(low, high) for each dimension, or a single
+   pair shared by every dimension; non-uniform ones take the bins + 1 bin
+   edges of each dimension. Without ranges every dimension covers 0-255. */
+static int php_opencv_histogram_ranges(zval *ranges_zval, int dims, int *sizes, zend_bool uniform, float **ranges, float *storage TSRMLS_DC)
+{
+    zval **dim_entry, **entry;
+    int i, j, count;
+
+    for (i = 0; i < dims; i++) {
+        count = uniform ? 2 : sizes[i] + 1;
+        ranges[i] = storage;
+        storage += count;
+
+        if (ranges_zval == NULL) {
+            ranges[i][0] = 0;
+            ranges[i][1] = 256;
+            continue;
+        }
+
+        /* A single shared pair */
+        if (uniform && zend_hash_index_find(Z_ARRVAL_P(ranges_zval), 0, (void **) &dim_entry) == SUCCESS
+                && Z_TYPE_PP(dim_entry) != IS_ARRAY) {
+            dim_entry = &ranges_zval;
+        } else if (zend_hash_index_find(Z_ARRVAL_P(ranges_zval), i, (void **) &dim_entry) == FAILURE
+                || Z_TYPE_PP(dim_entry) != IS_ARRAY) {
+            break;
+        }
+        if (zend_hash_num_elements(Z_ARRVAL_PP(dim_entry)) != count) {
+            break;
+        }
+        for (j = 0; j < count; j++) {
+            if (zend_hash_index_find(Z_ARRVAL_PP(dim_entry), j, (void **) &entry) == FAILURE) {
+                break;
+            }
+            ranges[i][j] = (float) php_opencv_histogram_number(entry);
+            if (j > 0 && ranges[i][j] <= ranges[i][j - 1]) {
+                break;
+            }
+        }
+        if (j < count) {
+            break;
+        }
+    }
+
+    if (i < dims) {
+        zend_throw_exception(opencv_ce_cvexception, uniform
+            ? "Ranges must be array(low, high), or one such pair per dimension, with low below high"
+            : "Non-uniform ranges must give the increasing bin edges, bins + 1 values, of every dimension", 0 TSRMLS_CC);
+        return 0;
+    }
+    return 1;
+}
+
+/* {{{ proto void __construct(int dims, int|array bins, int type [, array ranges [, bool uniform]])
+       Creates a histogram with dims dimensions. bins gives the number of
+       bins for every dimension, or for each one as an array. */
 PHP_METHOD(OpenCV_Histogram, __construct)
 {
-	long bins, sizes, type, uniform;
-    zval *ranges;
+	long dims, type;
+	zval *bins_zval, *ranges_zval = NULL, **entry;
+	zend_bool uniform = 1;
 	opencv_histogram_object *histogram_object;
-    CvHistogram *temp;
-    int cast_sizes;
+	CvHistogram *temp;
+	int sizes[CV_MAX_DIM], i, storage_size;
+	float *ranges[CV_MAX_DIM], *storage;
 
 	PHP_OPENCV_ERROR_HANDLING();
-	if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "lll|al", &bins, &sizes, &type, &ranges, &uniform) == FAILURE)
+	if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "lzl|a!b", &dims, &bins_zval, &type, &ranges_zval, &uniform) == FAILURE)
     {
 		PHP_OPENCV_RESTORE_ERRORS();
 		return;
 	}
 	PHP_OPENCV_RESTORE_ERRORS();
 
-    cast_sizes = sizes;
+    if (dims < 1 || dims > CV_MAX_DIM) {
+        zend_throw_exception_ex(opencv_ce_cvexception, 0 TSRMLS_CC, "Histograms must have between 1 and %d dimensions", CV_MAX_DIM);
+        return;
+    }
+    if (Z_TYPE_P(bins_zval) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(bins_zval)) != dims) {
+        zend_throw_exception(opencv_ce_cvexception, "The bins array must have one entry per dimension", 0 TSRMLS_CC);
+        return;
+    }
+
+    storage_size = 0;
+    for (i = 0; i < dims; i++) {
+        if (Z_TYPE_P(bins_zval) != IS_ARRAY) {
+            sizes[i] = (int) php_opencv_histogram_number(&bins_zval);
+        } else if (zend_hash_index_find(Z_ARRVAL_P(bins_zval), i, (void **) &entry) == SUCCESS) {
+            sizes[i] = (int) php_opencv_histogram_number(entry);
+        } else {
+            sizes[i] = 0;
+        }
+        if (sizes[i] < 1) {
+            zend_throw_exception(opencv_ce_cvexception, "Every dimension must have at least one bin", 0 TSRMLS_CC);
+            return;
+        }
+        storage_size += uniform ? 2 : sizes[i] + 1;
+    }
+
+    if (!uniform && ranges_zval == NULL) {
+        zend_throw_exception(opencv_ce_cvexception, "Non-uniform histograms need their bin edges as ranges", 0 TSRMLS_CC);
+        return;
+    }
+
+    storage = (float *) safe_emalloc(storage_size, sizeof(float), 0);
+    if (!php_opencv_histogram_ranges(ranges_zval, dims, sizes, uniform, ranges, storage TSRMLS_CC)) {
+        efree(storage);
+        return;
+    }
+
+    /* cvCreateHist copies the ranges */
+    temp = cvCreateHist(dims, sizes, type, ranges, uniform);
+    efree(storage);
 
-    temp = cvCreateHist(bins, &cast_sizes, type, NULL, 1);
     histogram_object = (opencv_histogram_object *) zend_object_store_get_object(getThis() TSRMLS_CC);
+    if (histogram_object->cvptr != NULL) {
+        cvReleaseHist(&histogram_object->cvptr);
+    }
     histogram_object->cvptr = temp;
     
 	php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
 
+/* Collects the images to count into a histogram, given as one Image or an
+   array of them, and checks that they can be. Between them the images
+   must have one channel per dimension, used in order. Throws and returns
+   0 if not. */
+static int php_opencv_histogram_images(zval *images_zval, int dims, IplImage *mask, std::vector<IplImage *> &images TSRMLS_DC)
+{
+    HashPosition pos;
+    zval **entry;
+    int channels = 0;
+    size_t i;
+
+    if (Z_TYPE_P(images_zval) == IS_ARRAY) {
+        for (zend_hash_internal_pointer_reset_ex(Z_ARRVAL_P(images_zval), &pos);
+                zend_hash_get_current_data_ex(Z_ARRVAL_P(images_zval), (void **) &entry, &pos) == SUCCESS;
+                zend_hash_move_forward_ex(Z_ARRVAL_P(images_zval), &pos)) {
+            if (Z_TYPE_PP(entry) != IS_OBJECT || !instanceof_function(Z_OBJCE_PP(entry), opencv_ce_image TSRMLS_CC)) {
+                images.clear();
+                break;
+            }
+            images.push_back(opencv_image_object_get(*entry TSRMLS_CC)->cvptr);
+        }
+    } else if (Z_TYPE_P(images_zval) == IS_OBJECT && instanceof_function(Z_OBJCE_P(images_zval), opencv_ce_image TSRMLS_CC)) {
+        images.push_back(opencv_image_object_get(images_zval TSRMLS_CC)->cvptr);
+    }
+    if (images.empty()) {
+        zend_throw_exception(opencv_ce_cvexception, "Histograms are calculated from an OpenCV\\Image or an array of them", 0 TSRMLS_CC);
+        return 0;
+    }
+
+    for (i = 0; i < images.size(); i++) {
+        if ((images[i]->depth != IPL_DEPTH_8U && images[i]->depth != IPL_DEPTH_32F) || images[i]->depth != images[0]->depth) {
+            zend_throw_exception(opencv_ce_cvexception, "Histograms can only be calculated from 8 bit or 32 bit float images, all of the same depth", 0 TSRMLS_CC);
+            return 0;
+        }
+        if (images[i]->width != images[0]->width || images[i]->height != images[0]->height) {
+            zend_throw_exception(opencv_ce_cvexception, "All of the images must be the same size", 0 TSRMLS_CC);
+            return 0;
+        }
+        channels += images[i]->nChannels;
+    }
+    if (channels != dims) {
+        zend_throw_exception_ex(opencv_ce_cvexception, 0 TSRMLS_CC, "The images have %d channels between them but the histogram has %d dimensions", channels, dims);
+        return 0;
+    }
+
+    if (mask != NULL && (mask->nChannels != 1 || mask->depth != IPL_DEPTH_8U
+            || mask->width != images[0]->width || mask->height != images[0]->height)) {
+        zend_throw_exception(opencv_ce_cvexception, "The mask must be a single channel 8 bit image the same size as the source", 0 TSRMLS_CC);
+        return 0;
+    }
+    return 1;
+}
+
+/* Counts multi-channel images by splitting them into single channel planes
+   first, as cvCalcHist needs. Only used where the histogram can't be
+   handed to cv::calcHist. */
+static void php_opencv_histogram_calc_planes(CvHistogram *hist, std::vector<IplImage *> &images, int accumulate, IplImage *mask TSRMLS_DC)
+{
+    std::vector<IplImage *> planes, split;
+    IplImage *channel[4];
+    size_t i;
+    int c;
+
+    for (i = 0; i < images.size(); i++) {
+        if (images[i]->nChannels == 1) {
+            planes.push_back(images[i]);
+            continue;
+        }
+        for (c = 0; c < 4; c++) {
+            channel[c] = NULL;
+            if (c < images[i]->nChannels) {
+                channel[c] = php_opencv_image_create(cvGetSize(images[i]), images[i]->depth, 1 TSRMLS_CC);
+                planes.push_back(channel[c]);
+                split.push_back(channel[c]);
+            }
+        }
+        cvSplit(images[i], channel[0], channel[1], channel[2], channel[3]);
+    }
+
+    try {
+        cvCalcHist(&planes[0], hist, accumulate, mask);
+    } catch (cv::Exception &e) {
+        for (i = 0; i < split.size(); i++) {
+            php_opencv_image_release(&split[i] TSRMLS_CC);
+        }
+        throw;
+    }
+    for (i = 0; i < split.size(); i++) {
+        php_opencv_image_release(&split[i] TSRMLS_CC);
+    }
+}
+
+/* {{{ proto Histogram calc(Image|array images [, bool accumulate [, Image mask]])
+       Counts pixels into the histogram, only where the mask is non-zero if
+       one is given. Each dimension takes the next channel of the images, so
+       a 3 dimensional histogram can be calculated from one 3 channel image
+       or three single channel ones. With accumulate the counts are added to
+       those already in the histogram instead of replacing them. */
 PHP_METHOD(OpenCV_Histogram, calc)
 {
-    zval *hist_zval, *image_zval;
+    zval *hist_zval, *images_zval, *mask_zval = NULL;
     opencv_histogram_object *hist_object;
-    opencv_image_object *image_object;
-    long accumulate = 0;
+    std::vector<IplImage *> images;
+    IplImage *mask = NULL;
+    zend_bool accumulate = 0;
+    int dims, sizes[CV_MAX_DIM];
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "OO|l", &hist_zval, opencv_ce_histogram, &image_zval, opencv_ce_image) == FAILURE)
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Oz|bO!", &hist_zval, opencv_ce_histogram, &images_zval, &accumulate, &mask_zval, opencv_ce_image) == FAILURE)
     {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    hist_object = opencv_histogram_object_get(hist_zval TSRMLS_CC);
+    if (mask_zval != NULL) {
+        mask = opencv_image_object_get(mask_zval TSRMLS_CC)->cvptr;
+    }
+    dims = cvGetDims(hist_object->cvptr->bins, sizes);
+    if (!php_opencv_histogram_images(images_zval, dims, mask, images TSRMLS_CC)) {
+        return;
+    }
+
+    try {
+#if CV_MAJOR_VERSION > 2 || (CV_MAJOR_VERSION == 2 && CV_MINOR_VERSION >= 3)
+        if (!CV_IS_SPARSE_HIST(hist_object->cvptr)) {
+            /* Dense bins can be filled in place by cv::calcHist, which reads
+               the channels of interleaved images directly, so every dimension
+               is counted in one pass over the pixels */
+            std::vector<cv::Mat> mats;
+            const float *ranges[CV_MAX_DIM];
+            cv::Mat bins = cv::cvarrToMat(hist_object->cvptr->bins);
+            size_t i;
+            int d;
+
+            for (i = 0; i < images.size(); i++) {
+                mats.push_back(cv::cvarrToMat(images[i]));
+            }
+            for (d = 0; d < dims; d++) {
+                ranges[d] = CV_IS_UNIFORM_HIST(hist_object->cvptr) ? hist_object->cvptr->thresh[d] : hist_object->cvptr->thresh2[d];
+            }
+            cv::calcHist(&mats[0], (int) mats.size(), NULL, mask != NULL ? cv::cvarrToMat(mask) : cv::Mat(),
+                bins, dims, sizes, ranges, CV_IS_UNIFORM_HIST(hist_object->cvptr) != 0, accumulate != 0);
+        } else
+#endif
+        php_opencv_histogram_calc_planes(hist_object->cvptr, images, accumulate, mask TSRMLS_CC);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+
+    RETVAL_ZVAL(hist_zval, 1, 0);
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* {{{ proto Histogram normalize([float factor])
+       Scales the bins so they add up to factor, 1.0 by default */
+PHP_METHOD(OpenCV_Histogram, normalize)
+{
+    zval *hist_zval;
+    opencv_histogram_object *hist_object;
+    double factor = 1.0;
+
     PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O|d", &hist_zval, opencv_ce_histogram, &factor) == FAILURE)
+    {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
 
-    hist_object = opencv_histogram_object_get(getThis() TSRMLS_CC);
-    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    cvCalcHist(&image_object->cvptr, hist_object->cvptr, accumulate, NULL);
+    hist_object = opencv_histogram_object_get(hist_zval TSRMLS_CC);
+    try {
+        cvNormalizeHist(hist_object->cvptr, factor);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
 
+    RETVAL_ZVAL(hist_zval, 1, 0);
     php_opencv_throw_exception(TSRMLS_C);
 }
+/* }}} */
+
+/* {{{ proto float compare(Histogram other, int method)
+       Compares two histograms with the same bins using one of the COMP_*
+       methods. Correlation and intersection are higher for closer
+       histograms, chi-square and Bhattacharyya distance lower. */
+PHP_METHOD(OpenCV_Histogram, compare)
+{
+    zval *hist_zval, *other_zval;
+    opencv_histogram_object *hist_object, *other_object;
+    int dims, other_dims, sizes[CV_MAX_DIM], other_sizes[CV_MAX_DIM], i;
+    long method;
+    double result;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "OOl", &hist_zval, opencv_ce_histogram, &other_zval, opencv_ce_histogram, &method) == FAILURE)
+    {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    if (method != CV_COMP_CORREL && method != CV_COMP_CHISQR && method != CV_COMP_INTERSECT && method != CV_COMP_BHATTACHARYYA) {
+        zend_throw_exception(opencv_ce_cvexception, "Unknown comparison method", 0 TSRMLS_CC);
+        return;
+    }
+
+    hist_object = opencv_histogram_object_get(hist_zval TSRMLS_CC);
+    other_object = opencv_histogram_object_get(other_zval TSRMLS_CC);
+
+    dims = cvGetDims(hist_object->cvptr->bins, sizes);
+    other_dims = cvGetDims(other_object->cvptr->bins, other_sizes);
+    for (i = 0; dims == other_dims && i < dims; i++) {
+        if (sizes[i] != other_sizes[i]) {
+            break;
+        }
+    }
+    if (dims != other_dims || i < dims) {
+        zend_throw_exception(opencv_ce_cvexception, "Histograms can only be compared with histograms that have the same bins", 0 TSRMLS_CC);
+        return;
+    }
+
+    try {
+        result = cvCompareHist(hist_object->cvptr, other_object->cvptr, method);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+
+    RETVAL_DOUBLE(result);
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* Fills return_value with the bins of dimension dim onwards, as nested
+   arrays, for the cell indexes already set in idx */
+static void php_opencv_histogram_bins_zval(CvHistogram *hist, int dims, int *sizes, int *idx, int dim, zval *return_value)
+{
+    int i;
+
+    array_init_size(return_value, sizes[dim]);
+    for (i = 0; i < sizes[dim]; i++) {
+        idx[dim] = i;
+        if (dim == dims - 1) {
+            add_next_index_double(return_value, cvGetRealND(hist->bins, idx));
+        } else {
+            zval *inner;
+            MAKE_STD_ZVAL(inner);
+            php_opencv_histogram_bins_zval(hist, dims, sizes, idx, dim + 1, inner);
+            add_next_index_zval(return_value, inner);
+        }
+    }
+}
+
+/* {{{ proto array getBins()
+       Returns the bin values, as nested arrays with one level per dimension */
+PHP_METHOD(OpenCV_Histogram, getBins)
+{
+    zval *hist_zval;
+    opencv_histogram_object *hist_object;
+    int dims, sizes[CV_MAX_DIM], idx[CV_MAX_DIM];
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O", &hist_zval, opencv_ce_histogram) == FAILURE)
+    {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    hist_object = opencv_histogram_object_get(hist_zval TSRMLS_CC);
+    dims = cvGetDims(hist_object->cvptr->bins, sizes);
+    php_opencv_histogram_bins_zval(hist_object->cvptr, dims, sizes, idx, 0, return_value);
+}
+/* }}} */
 
 /* {{{ opencv_histogram_methods[] */
 const zend_function_entry opencv_histogram_methods[] = { 
     PHP_ME(OpenCV_Histogram, __construct, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
     PHP_ME(OpenCV_Histogram, calc, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Histogram, normalize, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Histogram, compare, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Histogram, getBins, NULL, ZEND_ACC_PUBLIC)
     {NULL, NULL, NULL}
 };
 /* }}} */
@@ -133,6 +503,7 @@ PHP_MINIT_FUNCTION(opencv_histogram)
 
 	INIT_NS_CLASS_ENTRY(ce, "OpenCV", "Histogram", opencv_histogram_methods);
 	opencv_ce_histogram = zend_register_internal_class(&ce TSRMLS_CC);
+	opencv_ce_histogram->create_object = opencv_histogram_object_new;
 	
     #define REGISTER_HIST_LONG_CONST(const_name, value) \
 	zend_declare_class_constant_long(opencv_ce_histogram, const_name, sizeof(const_name)-1, (long)value TSRMLS_CC); \
@@ -141,6 +512,11 @@ PHP_MINIT_FUNCTION(opencv_histogram)
 	REGISTER_HIST_LONG_CONST("TYPE_SPARSE", CV_HIST_SPARSE);
     REGISTER_HIST_LONG_CONST("TYPE_ARRAY", CV_HIST_ARRAY);
 
+    REGISTER_HIST_LONG_CONST("COMP_CORREL", CV_COMP_CORREL);
+    REGISTER_HIST_LONG_CONST("COMP_CHISQR", CV_COMP_CHISQR);
+    REGISTER_HIST_LONG_CONST("COMP_INTERSECT", CV_COMP_INTERSECT);
+    REGISTER_HIST_LONG_CONST("COMP_BHATTACHARYYA", CV_COMP_BHATTACHARYYA);
+
 	return SUCCESS;
 }
 /* }}} */
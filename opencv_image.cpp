@@ -24,6 +24,9 @@
 
 #include "php_opencv.h"
 
+#include <float.h>
+#include <limits.h>
+
 zend_class_entry *opencv_ce_image;
 
 PHP_OPENCV_API opencv_image_object* opencv_image_object_get(zval *zobj TSRMLS_DC) {
@@ -34,36 +37,55 @@ PHP_OPENCV_API opencv_image_object* opencv_image_object_get(zval *zobj TSRMLS_DC
     return pobj;
 }
 
-#define PHP_OPENCV_ADD_IMAGE_LONG_PROPERTY(PROPERTY, MEMBER) \
-    do { \
-        zval *temp_prop; \
-        MAKE_STD_ZVAL(temp_prop); \
-        ZVAL_LONG(temp_prop, MEMBER); \
-        zend_hash_update(Z_OBJPROP_P(image_zval), PROPERTY, sizeof(PROPERTY), (void **) &temp_prop, sizeof(zval *), NULL); \
-    } while(0)
-
-
 PHP_OPENCV_API zval *php_opencv_make_image_zval(IplImage *image, zval *image_zval TSRMLS_DC) {
-    zval *return_value, *width, *height;
+    return php_opencv_make_image_zval_ex(image, image_zval, opencv_ce_image TSRMLS_CC);
+}
+
+/* Wraps an image in an object of the given subclass of OpenCV\Image */
+PHP_OPENCV_API zval *php_opencv_make_image_zval_ex(IplImage *image, zval *image_zval, zend_class_entry *ce TSRMLS_DC) {
     opencv_image_object *image_obj;
 
     if (image_zval == NULL) {
         MAKE_STD_ZVAL(image_zval);
     }
 
-    object_init_ex(image_zval, opencv_ce_image);
+    object_init_ex(image_zval, ce);
     image_obj = (opencv_image_object *) zend_object_store_get_object(image_zval TSRMLS_CC);
     image_obj->cvptr = image;
-
-    PHP_OPENCV_ADD_IMAGE_LONG_PROPERTY("width", image->width);
-    PHP_OPENCV_ADD_IMAGE_LONG_PROPERTY("height", image->height);
-    PHP_OPENCV_ADD_IMAGE_LONG_PROPERTY("nChannels", image->nChannels);
-    PHP_OPENCV_ADD_IMAGE_LONG_PROPERTY("alphaChannel", image->alphaChannel);
-    PHP_OPENCV_ADD_IMAGE_LONG_PROPERTY("depth", image->depth);
+    if (OPENCV_G(stats_enabled)) {
+        image_obj->stats_bytes = image->imageSize;
+        php_opencv_stats_image_memory(image->imageSize TSRMLS_CC);
+    }
 
     return image_zval;
 }
 
+/* Makes an image object a header over memory owned by something else. The
+   memory isn't the image's own, so it comes out of the statistics. */
+PHP_OPENCV_API void php_opencv_image_set_backing(opencv_image_object *image_obj, void *backing, php_opencv_release_func release TSRMLS_DC) {
+    image_obj->backing = backing;
+    image_obj->release_backing = release;
+    if (image_obj->stats_bytes != 0) {
+        php_opencv_stats_image_memory(-(long) image_obj->stats_bytes TSRMLS_CC);
+        image_obj->stats_bytes = 0;
+    }
+}
+
+/* Whether an IplImage can have this depth and number of channels */
+PHP_OPENCV_API int php_opencv_image_format_valid(int depth, int channels) {
+    switch (depth) {
+        case IPL_DEPTH_8U:
+        case IPL_DEPTH_8S:
+        case IPL_DEPTH_16U:
+        case IPL_DEPTH_16S:
+        case IPL_DEPTH_32S:
+        case IPL_DEPTH_32F:
+        case IPL_DEPTH_64F:
+            return channels >= 1 && channels <= 4;
+    }
+    return 0;
+}
+
 void opencv_image_object_destroy(void *object TSRMLS_DC)
 {
     opencv_image_object *image = (opencv_image_object *)object;
@@ -71,8 +93,16 @@ void opencv_image_object_destroy(void *object TSRMLS_DC)
     zend_hash_destroy(image->std.properties);
     FREE_HASHTABLE(image->std.properties);
 
-    if(image->cvptr != NULL){
-        cvReleaseImage(&image->cvptr);
+    if (image->stats_bytes != 0) {
+        php_opencv_stats_image_memory(-(long) image->stats_bytes TSRMLS_CC);
+    }
+    if (image->backing != NULL) {
+        if (image->cvptr != NULL) {
+            cvReleaseImageHeader(&image->cvptr);
+        }
+        image->release_backing(image->backing TSRMLS_CC);
+    } else if(image->cvptr != NULL){
+        php_opencv_image_release(&image->cvptr TSRMLS_CC);
     }
     efree(image);
 }
@@ -96,7 +126,7 @@ static zend_object_value opencv_image_object_new(zend_class_entry *ce TSRMLS_DC)
     object_properties_init(&image->std, ce);
 #endif
     retval.handle = zend_objects_store_put(image, NULL, (zend_objects_free_object_storage_t)opencv_image_object_destroy, NULL TSRMLS_CC);
-    retval.handlers = zend_get_std_object_handlers();
+    retval.handlers = &opencv_mat_object_handlers;
     return retval;
 }
 
@@ -116,7 +146,7 @@ PHP_METHOD(OpenCV_Image, __construct)
 	}
 	PHP_OPENCV_RESTORE_ERRORS();
 
-    temp = cvCreateImage(cvSize(width, height), format, channels);
+    temp = php_opencv_image_create(cvSize(width, height), format, channels TSRMLS_CC);
     php_opencv_make_image_zval(temp, getThis() TSRMLS_CC);
 	php_opencv_throw_exception(TSRMLS_C);
 }
@@ -174,6 +204,134 @@ PHP_METHOD(OpenCV_Image, save) {
     }
 }
 
+/* {{{ proto Image loadScaled(string filename, int maxWidth, int maxHeight [, int mode [, int interpolation]])
+       Loads an image shrunk to fit within maxWidth x maxHeight, keeping the
+       aspect ratio. Smaller images are not enlarged. When the extension is
+       built with libjpeg, JPEGs are decoded at a reduced scale, so a preview
+       of a huge photo never needs the full size image in memory. Every other
+       format, including TIFF, is decoded in full and then resized. */
+PHP_METHOD(OpenCV_Image, loadScaled) {
+    IplImage *temp;
+    char *filename;
+    int filename_len;
+    long max_width, max_height, mode = CV_LOAD_IMAGE_COLOR, interpolation = CV_INTER_AREA;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "sll|ll", &filename, &filename_len, &max_width, &max_height, &mode, &interpolation) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    if (max_width <= 0 || max_height <= 0) {
+        zend_throw_exception(opencv_ce_cvexception, "The width and height must be greater than zero", 0 TSRMLS_CC);
+        return;
+    }
+
+    php_opencv_basedir_check(filename TSRMLS_CC);
+    if (EG(exception)) {
+        return;
+    }
+
+    try {
+        temp = php_opencv_load_scaled(filename, max_width, max_height, mode, 0, interpolation);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+    if (temp == NULL) {
+        cvSetErrStatus(CV_StsOk);
+        zend_throw_exception(opencv_ce_cvexception, "Could not load the image - check it exists and the codec is available", 0 TSRMLS_CC);
+        return;
+    }
+
+    php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* {{{ proto Image decode(string bytes [, int mode])
+       Decodes an image held in memory, such as an uploaded file */
+PHP_METHOD(OpenCV_Image, decode) {
+    IplImage *temp;
+    char *bytes;
+    int bytes_len;
+    long mode = CV_LOAD_IMAGE_COLOR;
+    CvMat buffer;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "s|l", &bytes, &bytes_len, &mode) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    buffer = cvMat(1, bytes_len, CV_8UC1, bytes);
+    try {
+        temp = cvDecodeImage(&buffer, mode);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+    if (temp == NULL) {
+        cvSetErrStatus(CV_StsOk);
+        zend_throw_exception(opencv_ce_cvexception, "Could not decode the image - check the data is complete and the codec is available", 0 TSRMLS_CC);
+        return;
+    }
+
+    php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* {{{ proto string encode(string ext [, array params])
+       Encodes the image into a string using the codec for the given extension */
+PHP_METHOD(OpenCV_Image, encode) {
+    opencv_image_object *image_object;
+    zval *image_zval, *params_zval = NULL;
+    char *ext, *full_ext;
+    int ext_len;
+    std::vector<int> params;
+    CvMat *buffer;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Os|a", &image_zval, opencv_ce_image, &ext, &ext_len, &params_zval) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    php_opencv_array_to_params(params_zval, params TSRMLS_CC);
+    params.push_back(0);
+
+    /* Accept both "jpg" and ".jpg" */
+    if (ext_len > 0 && ext[0] != '.') {
+        spprintf(&full_ext, 0, ".%s", ext);
+    } else {
+        full_ext = estrndup(ext, ext_len);
+    }
+
+    try {
+        buffer = cvEncodeImage(full_ext, image_object->cvptr, &params[0]);
+    } catch (cv::Exception &e) {
+        efree(full_ext);
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+    efree(full_ext);
+
+    if (buffer == NULL) {
+        cvSetErrStatus(CV_StsOk);
+        zend_throw_exception(opencv_ce_cvexception, "Failed to encode image", 0 TSRMLS_CC);
+        return;
+    }
+
+    RETVAL_STRINGL((char *) buffer->data.ptr, buffer->rows * buffer->cols, 1);
+    cvReleaseMat(&buffer);
+}
+/* }}} */
+
 /* {{{ */
 PHP_METHOD(OpenCV_Image, setImageROI) {
     opencv_image_object *image_object;
@@ -238,28 +396,66 @@ PHP_METHOD(OpenCV_Image, resetImageROI) {
 }
 /* }}} */
 
-/* {{{ */
+/* Works out where a filter should write its result. Without a destination
+   the source is cloned into a new Image as before; otherwise the destination
+   (which may be the source itself, for in-place operation) is checked and
+   returned to the caller so calls can still be chained. */
+static IplImage *php_opencv_image_filter_dst(IplImage *src, zval *dst_zval, zval *return_value TSRMLS_DC)
+{
+    opencv_image_object *dst_object;
+    CvSize src_size, dst_size;
+
+    if (dst_zval == NULL) {
+        php_opencv_make_image_zval(php_opencv_image_clone(src TSRMLS_CC), return_value TSRMLS_CC);
+        return opencv_image_object_get(return_value TSRMLS_CC)->cvptr;
+    }
+
+    dst_object = opencv_image_object_get(dst_zval TSRMLS_CC);
+    src_size = cvGetSize(src);
+    dst_size = cvGetSize(dst_object->cvptr);
+    if (src_size.width != dst_size.width || src_size.height != dst_size.height
+            || src->depth != dst_object->cvptr->depth || src->nChannels != dst_object->cvptr->nChannels) {
+        zend_throw_exception(opencv_ce_cvexception, "The destination image must have the same size, depth and channels as the source", 0 TSRMLS_CC);
+        return NULL;
+    }
+
+    RETVAL_ZVAL(dst_zval, 1, 0);
+    return dst_object->cvptr;
+}
+
+/* {{{ proto Image smooth(int type, int param1, int param2, int param3, int param4 [, Image dst])
+       Pass a destination image (or the image itself) to avoid allocating a new one */
 PHP_METHOD(OpenCV_Image, smooth) {
-    opencv_image_object *image_object, *dst_object;
-    zval *image_zval;
-    IplImage *temp;
+    opencv_image_object *image_object;
+    zval *image_zval, *dst_zval = NULL;
+    IplImage *src, *dst;
     long params[4] = { 3, 0, 0, 0 };
     long smoothType = 0;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Olllll", &image_zval, opencv_ce_image, &smoothType, &params[0], &params[1], &params[2], &params[3]) == FAILURE) {
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Olllll|O!", &image_zval, opencv_ce_image, &smoothType, &params[0], &params[1], &params[2], &params[3], &dst_zval, opencv_ce_image) == FAILURE) {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    dst = php_opencv_image_filter_dst(image_object->cvptr, dst_zval, return_value TSRMLS_CC);
+    if (dst == NULL) {
+        return;
+    }
 
-    temp = cvCloneImage(image_object->cvptr);
-    *return_value = *php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
-    dst_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    /* The median and bilateral filters can't work in place */
+    src = image_object->cvptr;
+    if (src == dst && (smoothType == CV_MEDIAN || smoothType == CV_BILATERAL)) {
+        src = php_opencv_image_clone(image_object->cvptr TSRMLS_CC);
+    }
+
+    cvSmooth(src, dst, smoothType, params[0], params[1], params[2], params[3]);
 
-    cvSmooth(image_object->cvptr, dst_object->cvptr, smoothType, params[0], params[1], params[2], params[3]);
+    if (src != image_object->cvptr) {
+        php_opencv_image_release(&src TSRMLS_CC);
+    }
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
@@ -279,7 +475,7 @@ PHP_METHOD(OpenCV_Image, laplace) {
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCreateImage(cvGetSize(image_object->cvptr), IPL_DEPTH_16S, image_object->cvptr->nChannels);
+    temp = php_opencv_image_create(cvGetSize(image_object->cvptr), IPL_DEPTH_16S, image_object->cvptr->nChannels TSRMLS_CC);
     *return_value = *php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
     dst_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
 
@@ -303,7 +499,7 @@ PHP_METHOD(OpenCV_Image, sobel) {
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCreateImage(cvGetSize(image_object->cvptr), IPL_DEPTH_16S, image_object->cvptr->nChannels);
+    temp = php_opencv_image_create(cvGetSize(image_object->cvptr), IPL_DEPTH_16S, image_object->cvptr->nChannels TSRMLS_CC);
     *return_value = *php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
     dst_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
 
@@ -312,171 +508,187 @@ PHP_METHOD(OpenCV_Image, sobel) {
 }
 /* }}} */
 
-/* {{{ */
+/* {{{ proto Image erode(int iterations [, Image dst])
+       Pass a destination image (or the image itself) to avoid allocating a new one */
 PHP_METHOD(OpenCV_Image, erode) {
-    opencv_image_object *image_object, *dst_object;
-    zval *image_zval;
-    IplImage *temp;
+    opencv_image_object *image_object;
+    zval *image_zval, *dst_zval = NULL;
+    IplImage *dst;
     long iterations = 1;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol", &image_zval, opencv_ce_image, &iterations) == FAILURE) {
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|O!", &image_zval, opencv_ce_image, &iterations, &dst_zval, opencv_ce_image) == FAILURE) {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCloneImage(image_object->cvptr);
-    *return_value = *php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
-    dst_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    dst = php_opencv_image_filter_dst(image_object->cvptr, dst_zval, return_value TSRMLS_CC);
+    if (dst == NULL) {
+        return;
+    }
 
-    cvErode(image_object->cvptr, dst_object->cvptr, NULL, iterations);
+    cvErode(image_object->cvptr, dst, NULL, iterations);
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
 
-/* {{{ */
+/* {{{ proto Image dilate(int iterations [, Image dst])
+       Pass a destination image (or the image itself) to avoid allocating a new one */
 PHP_METHOD(OpenCV_Image, dilate) {
-    opencv_image_object *image_object, *dst_object;
-    zval *image_zval;
-    IplImage *temp;
+    opencv_image_object *image_object;
+    zval *image_zval, *dst_zval = NULL;
+    IplImage *dst;
     long iterations = 1;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol", &image_zval, opencv_ce_image, &iterations) == FAILURE) {
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|O!", &image_zval, opencv_ce_image, &iterations, &dst_zval, opencv_ce_image) == FAILURE) {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCloneImage(image_object->cvptr);
-    *return_value = *php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
-    dst_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    dst = php_opencv_image_filter_dst(image_object->cvptr, dst_zval, return_value TSRMLS_CC);
+    if (dst == NULL) {
+        return;
+    }
 
-    cvDilate(image_object->cvptr, dst_object->cvptr, NULL, iterations);
+    cvDilate(image_object->cvptr, dst, NULL, iterations);
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
 
-/* {{{ */
+/* {{{ proto Image open(int iterations [, Image dst])
+       Pass a destination image (or the image itself) to avoid allocating a new one */
 PHP_METHOD(OpenCV_Image, open) {
-    opencv_image_object *image_object, *dst_object;
-    zval *image_zval;
-    IplImage *temp;
+    opencv_image_object *image_object;
+    zval *image_zval, *dst_zval = NULL;
+    IplImage *dst;
     long iterations = 1;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol", &image_zval, opencv_ce_image, &iterations) == FAILURE) {
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|O!", &image_zval, opencv_ce_image, &iterations, &dst_zval, opencv_ce_image) == FAILURE) {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCloneImage(image_object->cvptr);
-    *return_value = *php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
-    dst_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    dst = php_opencv_image_filter_dst(image_object->cvptr, dst_zval, return_value TSRMLS_CC);
+    if (dst == NULL) {
+        return;
+    }
 
-    cvMorphologyEx(image_object->cvptr, dst_object->cvptr, NULL, NULL, CV_MOP_OPEN, iterations);
+    cvMorphologyEx(image_object->cvptr, dst, NULL, NULL, CV_MOP_OPEN, iterations);
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
 
-/* {{{ */
+/* {{{ proto Image close(int iterations [, Image dst])
+       Pass a destination image (or the image itself) to avoid allocating a new one */
 PHP_METHOD(OpenCV_Image, close) {
-    opencv_image_object *image_object, *dst_object;
-    zval *image_zval;
-    IplImage *temp;
+    opencv_image_object *image_object;
+    zval *image_zval, *dst_zval = NULL;
+    IplImage *dst;
     long iterations = 1;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol", &image_zval, opencv_ce_image, &iterations) == FAILURE) {
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|O!", &image_zval, opencv_ce_image, &iterations, &dst_zval, opencv_ce_image) == FAILURE) {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCloneImage(image_object->cvptr);
-    *return_value = *php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
-    dst_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    dst = php_opencv_image_filter_dst(image_object->cvptr, dst_zval, return_value TSRMLS_CC);
+    if (dst == NULL) {
+        return;
+    }
 
-    cvMorphologyEx(image_object->cvptr, dst_object->cvptr, NULL, NULL, CV_MOP_CLOSE, iterations);
+    cvMorphologyEx(image_object->cvptr, dst, NULL, NULL, CV_MOP_CLOSE, iterations);
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
 
-/* {{{ */
+/* {{{ proto Image gradient(int iterations [, Image dst])
+       Pass a destination image (or the image itself) to avoid allocating a new one */
 PHP_METHOD(OpenCV_Image, gradient) {
-    opencv_image_object *image_object, *dst_object;
-    zval *image_zval;
-    IplImage *temp, *temp2;
+    opencv_image_object *image_object;
+    zval *image_zval, *dst_zval = NULL;
+    IplImage *dst, *scratch;
     long iterations = 1;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol", &image_zval, opencv_ce_image, &iterations) == FAILURE) {
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|O!", &image_zval, opencv_ce_image, &iterations, &dst_zval, opencv_ce_image) == FAILURE) {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCloneImage(image_object->cvptr);
-    temp2 = cvCloneImage(image_object->cvptr);
-    *return_value = *php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
-    dst_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    dst = php_opencv_image_filter_dst(image_object->cvptr, dst_zval, return_value TSRMLS_CC);
+    if (dst == NULL) {
+        return;
+    }
 
-    cvMorphologyEx(image_object->cvptr, dst_object->cvptr, temp2, NULL, CV_MOP_GRADIENT, iterations);
+    /* The gradient needs a scratch image, which only has to match in shape */
+    scratch = php_opencv_image_create(cvGetSize(image_object->cvptr), image_object->cvptr->depth, image_object->cvptr->nChannels TSRMLS_CC);
+    cvMorphologyEx(image_object->cvptr, dst, scratch, NULL, CV_MOP_GRADIENT, iterations);
+    php_opencv_image_release(&scratch TSRMLS_CC);
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
 
-/* {{{ */
+/* {{{ proto Image topHat(int iterations [, Image dst])
+       Pass a destination image (or the image itself) to avoid allocating a new one */
 PHP_METHOD(OpenCV_Image, topHat) {
-    opencv_image_object *image_object, *dst_object;
-    zval *image_zval;
-    IplImage *temp;
+    opencv_image_object *image_object;
+    zval *image_zval, *dst_zval = NULL;
+    IplImage *dst;
     long iterations = 1;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol", &image_zval, opencv_ce_image, &iterations) == FAILURE) {
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|O!", &image_zval, opencv_ce_image, &iterations, &dst_zval, opencv_ce_image) == FAILURE) {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCloneImage(image_object->cvptr);
-    *return_value = *php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
-    dst_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    dst = php_opencv_image_filter_dst(image_object->cvptr, dst_zval, return_value TSRMLS_CC);
+    if (dst == NULL) {
+        return;
+    }
 
-    cvMorphologyEx(image_object->cvptr, dst_object->cvptr, NULL, NULL, CV_MOP_TOPHAT, iterations);
+    cvMorphologyEx(image_object->cvptr, dst, NULL, NULL, CV_MOP_TOPHAT, iterations);
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
 
-/* {{{ */
+/* {{{ proto Image blackHat(int iterations [, Image dst])
+       Pass a destination image (or the image itself) to avoid allocating a new one */
 PHP_METHOD(OpenCV_Image, blackHat) {
-    opencv_image_object *image_object, *dst_object;
-    zval *image_zval;
-    IplImage *temp;
+    opencv_image_object *image_object;
+    zval *image_zval, *dst_zval = NULL;
+    IplImage *dst;
     long iterations = 1;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol", &image_zval, opencv_ce_image, &iterations) == FAILURE) {
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|O!", &image_zval, opencv_ce_image, &iterations, &dst_zval, opencv_ce_image) == FAILURE) {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCloneImage(image_object->cvptr);
-    *return_value = *php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
-    dst_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    dst = php_opencv_image_filter_dst(image_object->cvptr, dst_zval, return_value TSRMLS_CC);
+    if (dst == NULL) {
+        return;
+    }
 
-    cvMorphologyEx(image_object->cvptr, dst_object->cvptr, NULL, NULL, CV_MOP_BLACKHAT, iterations);
+    cvMorphologyEx(image_object->cvptr, dst, NULL, NULL, CV_MOP_BLACKHAT, iterations);
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
@@ -517,9 +729,9 @@ PHP_METHOD(OpenCV_Image, pyrDown) {
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCreateImage(
+    temp = php_opencv_image_create(
             cvSize(image_object->cvptr->width / 2, image_object->cvptr->height / 2),
-            image_object->cvptr->depth, image_object->cvptr->nChannels);
+            image_object->cvptr->depth, image_object->cvptr->nChannels TSRMLS_CC);
     php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
     dst_object = opencv_image_object_get(return_value TSRMLS_CC);
 
@@ -543,9 +755,9 @@ PHP_METHOD(OpenCV_Image, pyrUp) {
     PHP_OPENCV_RESTORE_ERRORS();
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    temp = cvCreateImage(
+    temp = php_opencv_image_create(
             cvSize(image_object->cvptr->width * 2, image_object->cvptr->height * 2),
-            image_object->cvptr->depth, image_object->cvptr->nChannels);
+            image_object->cvptr->depth, image_object->cvptr->nChannels TSRMLS_CC);
     php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
     dst_object = opencv_image_object_get(return_value TSRMLS_CC);
 
@@ -570,17 +782,20 @@ PHP_METHOD(OpenCV_Image, canny) {
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
     if (image_object->cvptr->nChannels > 1) {
-        grey_image = cvCreateImage(cvGetSize(image_object->cvptr), IPL_DEPTH_8U, 1);
+        grey_image = php_opencv_image_create(cvGetSize(image_object->cvptr), IPL_DEPTH_8U, 1 TSRMLS_CC);
         cvCvtColor(image_object->cvptr, grey_image, CV_BGR2GRAY);
     } else {
         grey_image = image_object->cvptr;
     }
 
-    temp = cvCreateImage(cvGetSize(image_object->cvptr), IPL_DEPTH_8U, 1);
+    temp = php_opencv_image_create(cvGetSize(image_object->cvptr), IPL_DEPTH_8U, 1 TSRMLS_CC);
     php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
     dst_object = opencv_image_object_get(return_value TSRMLS_CC);
 
     cvCanny(grey_image, dst_object->cvptr, lowThresh, highThresh, apertureSize);
+    if (grey_image != image_object->cvptr) {
+        php_opencv_image_release(&grey_image TSRMLS_CC);
+    }
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
@@ -601,14 +816,14 @@ PHP_METHOD(OpenCV_Image, split) {
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
 
-    IplImage **planes = (IplImage **) ecalloc(image_object->cvptr->nChannels, sizeof(IplImage *));
+    IplImage **planes = (IplImage **) ecalloc(4, sizeof(IplImage *));
     zval **return_zvals = (zval **) ecalloc(image_object->cvptr->nChannels, sizeof(zval *));
 
     for (i = 0; i < image_object->cvptr->nChannels; i++) {
         opencv_image_object *current_plane;
         MAKE_STD_ZVAL(return_zvals[i]);
         object_init_ex(return_zvals[i], opencv_ce_image);
-        temp = cvCreateImage(cvGetSize(image_object->cvptr), IPL_DEPTH_8U, 1);
+        temp = php_opencv_image_create(cvGetSize(image_object->cvptr), IPL_DEPTH_8U, 1 TSRMLS_CC);
         php_opencv_make_image_zval(temp, return_zvals[i] TSRMLS_CC);
         planes[i] = temp;
     }
@@ -647,7 +862,7 @@ PHP_METHOD(OpenCV_Image, convertColor) {
         channels = image_object->cvptr->nChannels;
     }
 
-    temp = cvCreateImage(cvGetSize(image_object->cvptr), image_object->cvptr->depth, channels);
+    temp = php_opencv_image_create(cvGetSize(image_object->cvptr), image_object->cvptr->depth, channels TSRMLS_CC);
     cvCvtColor(image_object->cvptr, temp, code);
     php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
 
@@ -673,7 +888,7 @@ PHP_METHOD(OpenCV_Image, backProject)
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
     hist_object = opencv_histogram_object_get(hist_zval TSRMLS_CC);
 
-    temp = cvCloneImage(image_object->cvptr);
+    temp = php_opencv_image_clone(image_object->cvptr TSRMLS_CC);
     cvCalcBackProject(&image_object->cvptr, temp, hist_object->cvptr);
     php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
 
@@ -681,6 +896,70 @@ PHP_METHOD(OpenCV_Image, backProject)
 }
 /* }}} */
 
+/* {{{ proto Image equalize([Image dst])
+       Spreads a single channel 8 bit image's histogram over the full range
+       of values, to even out brightness and contrast */
+PHP_METHOD(OpenCV_Image, equalize)
+{
+    opencv_image_object *image_object;
+    zval *image_zval, *dst_zval = NULL;
+    IplImage *dst;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O|O!", &image_zval, opencv_ce_image, &dst_zval, opencv_ce_image) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    if (image_object->cvptr->nChannels != 1 || image_object->cvptr->depth != IPL_DEPTH_8U) {
+        zend_throw_exception(opencv_ce_cvexception, "Only single channel 8 bit images can be equalized", 0 TSRMLS_CC);
+        return;
+    }
+
+    dst = php_opencv_image_filter_dst(image_object->cvptr, dst_zval, return_value TSRMLS_CC);
+    if (dst == NULL) {
+        return;
+    }
+
+    cvEqualizeHist(image_object->cvptr, dst);
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* Runs matchTemplate into a native response map, checking the inputs first.
+   Throws and returns NULL if they can't be matched. */
+static IplImage *php_opencv_image_match(IplImage *image, IplImage *templ, long mode TSRMLS_DC)
+{
+    CvSize image_size = cvGetSize(image), templ_size = cvGetSize(templ);
+    IplImage *map;
+
+    if (mode < CV_TM_SQDIFF || mode > CV_TM_CCOEFF_NORMED) {
+        zend_throw_exception(opencv_ce_cvexception, "Unknown template matching mode", 0 TSRMLS_CC);
+        return NULL;
+    }
+    if ((image->depth != IPL_DEPTH_8U && image->depth != IPL_DEPTH_32F)
+            || templ->depth != image->depth || templ->nChannels != image->nChannels) {
+        zend_throw_exception(opencv_ce_cvexception, "The image and template must both be 8 bit or 32 bit float, with the same number of channels", 0 TSRMLS_CC);
+        return NULL;
+    }
+    if (templ_size.width > image_size.width || templ_size.height > image_size.height) {
+        zend_throw_exception(opencv_ce_cvexception, "The template must not be larger than the image", 0 TSRMLS_CC);
+        return NULL;
+    }
+
+    map = php_opencv_image_create(cvSize(image_size.width - templ_size.width + 1, image_size.height - templ_size.height + 1), IPL_DEPTH_32F, 1 TSRMLS_CC);
+    try {
+        cvMatchTemplate(image, templ, map, mode);
+    } catch (cv::Exception &e) {
+        php_opencv_image_release(&map TSRMLS_CC);
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return NULL;
+    }
+    return map;
+}
+
 PHP_METHOD(OpenCV_Image, matchTemplate)
 {
     opencv_image_object *image_object, *template_object, *dst_object;
@@ -698,17 +977,298 @@ PHP_METHOD(OpenCV_Image, matchTemplate)
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
     template_object = opencv_image_object_get(template_zval TSRMLS_CC);
 
-    temp = cvCreateImage(cvSize(
-                image_object->cvptr->width - template_object->cvptr->width + 1,
-                image_object->cvptr->height - template_object->cvptr->height + 1),
-            IPL_DEPTH_32F, 1);
-
-    cvMatchTemplate(image_object->cvptr, template_object->cvptr, temp, mode);
+    temp = php_opencv_image_match(image_object->cvptr, template_object->cvptr, mode TSRMLS_CC);
+    if (temp == NULL) {
+        return;
+    }
     php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
 
+
+/* Adds array('x' => int, 'y' => int) to an array */
+static void php_opencv_add_assoc_point(zval *array, const char *key, cv::Point point)
+{
+    zval *temp;
+
+    MAKE_STD_ZVAL(temp);
+    array_init(temp);
+    add_assoc_long(temp, "x", point.x);
+    add_assoc_long(temp, "y", point.y);
+    add_assoc_zval(array, (char *) key, temp);
+}
+
+/* {{{ proto array minMaxLoc()
+       Returns the smallest and largest values of a single-channel image and
+       where they are, as array('min', 'max', 'minLoc', 'maxLoc') */
+PHP_METHOD(OpenCV_Image, minMaxLoc)
+{
+    opencv_image_object *image_object;
+    zval *image_zval;
+    double min_val, max_val;
+    cv::Point min_loc, max_loc;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O", &image_zval, opencv_ce_image) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    if (image_object->cvptr->nChannels != 1) {
+        zend_throw_exception(opencv_ce_cvexception, "The image must have a single channel", 0 TSRMLS_CC);
+        return;
+    }
+
+    try {
+        cv::minMaxLoc(cv::cvarrToMat(image_object->cvptr), &min_val, &max_val, &min_loc, &max_loc);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+
+    array_init(return_value);
+    add_assoc_double(return_value, "min", min_val);
+    add_assoc_double(return_value, "max", max_val);
+    php_opencv_add_assoc_point(return_value, "minLoc", min_loc);
+    php_opencv_add_assoc_point(return_value, "maxLoc", max_loc);
+}
+/* }}} */
+
+/* {{{ proto array matchTemplateBest(Image template, int mode)
+       Returns the best match as array('x', 'y', 'score') without creating
+       the response map as an Image. The best score is the lowest for the
+       TM_SQDIFF modes and the highest for the others. Coordinates are
+       relative to the image, not its ROI. */
+PHP_METHOD(OpenCV_Image, matchTemplateBest)
+{
+    opencv_image_object *image_object, *template_object;
+    zval *image_zval, *template_zval;
+    IplImage *map;
+    long mode;
+    CvRect roi;
+    std::vector<php_opencv_peak> peaks;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "OOl", &image_zval, opencv_ce_image, &template_zval, opencv_ce_image, &mode) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    template_object = opencv_image_object_get(template_zval TSRMLS_CC);
+
+    map = php_opencv_image_match(image_object->cvptr, template_object->cvptr, mode TSRMLS_CC);
+    if (map == NULL) {
+        return;
+    }
+
+    try {
+        cv::Mat map_mat = cv::cvarrToMat(map);
+        php_opencv_find_peaks(map_mat, php_opencv_match_minimises(mode) ? DBL_MAX : -DBL_MAX, 1, 0, php_opencv_match_minimises(mode), peaks);
+    } catch (cv::Exception &e) {
+        php_opencv_image_release(&map TSRMLS_CC);
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+    php_opencv_image_release(&map TSRMLS_CC);
+    php_opencv_throw_exception(TSRMLS_C);
+
+    if (peaks.empty()) {
+        RETURN_FALSE;
+    }
+    roi = cvGetImageROI(image_object->cvptr);
+    array_init(return_value);
+    add_assoc_long(return_value, "x", peaks[0].x + roi.x);
+    add_assoc_long(return_value, "y", peaks[0].y + roi.y);
+    add_assoc_double(return_value, "score", peaks[0].score);
+}
+/* }}} */
+
+/* {{{ proto array matchTemplatePeaks(Image template, int mode, float threshold [, int maxCount [, int nmsRadius]])
+       Returns up to maxCount matches scoring at least threshold (at most,
+       for the TM_SQDIFF modes), best first, as arrays of ('x', 'y', 'score').
+       Matches within nmsRadius pixels of a better one are dropped.
+       Coordinates are relative to the image, not its ROI. */
+PHP_METHOD(OpenCV_Image, matchTemplatePeaks)
+{
+    opencv_image_object *image_object, *template_object;
+    zval *image_zval, *template_zval;
+    IplImage *map;
+    long mode, max_count = 1, radius = 0;
+    double threshold;
+    CvRect roi;
+    std::vector<php_opencv_peak> peaks;
+    size_t i;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "OOld|ll", &image_zval, opencv_ce_image, &template_zval, opencv_ce_image, &mode, &threshold, &max_count, &radius) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    template_object = opencv_image_object_get(template_zval TSRMLS_CC);
+
+    map = php_opencv_image_match(image_object->cvptr, template_object->cvptr, mode TSRMLS_CC);
+    if (map == NULL) {
+        return;
+    }
+
+    try {
+        cv::Mat map_mat = cv::cvarrToMat(map);
+        php_opencv_find_peaks(map_mat, threshold, max_count, radius, php_opencv_match_minimises(mode), peaks);
+    } catch (cv::Exception &e) {
+        php_opencv_image_release(&map TSRMLS_CC);
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+    php_opencv_image_release(&map TSRMLS_CC);
+    php_opencv_throw_exception(TSRMLS_C);
+
+    roi = cvGetImageROI(image_object->cvptr);
+    for (i = 0; i < peaks.size(); i++) {
+        peaks[i].x += roi.x;
+        peaks[i].y += roi.y;
+    }
+    php_opencv_peaks_to_array(peaks, return_value);
+}
+/* }}} */
+
+/* {{{ proto array matchTemplateMultiScale(Image template, int mode [, array options])
+       Finds the template at several sizes, searching a reduced copy of the
+       image first and then only the areas around the candidates at full
+       size. Options are "scales" (array of template scale factors, default
+       array(1.0)), "levels" (how many times the image may be halved for the
+       first search, default 2), "threshold" (the worst score to accept),
+       "maxCount" (default 1) and "margin" (extra pixels searched around each
+       candidate, default 4). Returns the hits best first as arrays of ('x',
+       'y', 'width', 'height', 'score', 'scale'). */
+PHP_METHOD(OpenCV_Image, matchTemplateMultiScale)
+{
+    opencv_image_object *image_object, *template_object;
+    zval *image_zval, *template_zval, *options_zval = NULL, *scales_zval, **entry, *temp;
+    long mode, levels, max_count, margin;
+    double threshold;
+    std::vector<double> scales;
+    std::vector<php_opencv_match> matches;
+    HashPosition pos;
+    CvRect roi;
+    size_t i;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "OOl|a", &image_zval, opencv_ce_image, &template_zval, opencv_ce_image, &mode, &options_zval) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    template_object = opencv_image_object_get(template_zval TSRMLS_CC);
+
+    scales_zval = php_opencv_option_find(options_zval, "scales");
+    if (scales_zval != NULL && Z_TYPE_P(scales_zval) == IS_ARRAY) {
+        for (zend_hash_internal_pointer_reset_ex(Z_ARRVAL_P(scales_zval), &pos);
+                zend_hash_get_current_data_ex(Z_ARRVAL_P(scales_zval), (void **) &entry, &pos) == SUCCESS;
+                zend_hash_move_forward_ex(Z_ARRVAL_P(scales_zval), &pos)) {
+            zval tmp = **entry;
+            zval_copy_ctor(&tmp);
+            convert_to_double(&tmp);
+            if (Z_DVAL(tmp) > 0) {
+                scales.push_back(Z_DVAL(tmp));
+            }
+        }
+    }
+    if (scales.empty()) {
+        scales.push_back(1.0);
+    }
+
+    levels = php_opencv_option_long(options_zval, "levels", 2);
+    max_count = php_opencv_option_long(options_zval, "maxCount", 1);
+    margin = php_opencv_option_long(options_zval, "margin", 4);
+    threshold = php_opencv_option_double(options_zval, "threshold", php_opencv_match_minimises(mode) ? DBL_MAX : -DBL_MAX);
+
+    if (levels < 0 || levels > 8) {
+        zend_throw_exception(opencv_ce_cvexception, "The number of levels must be between 0 and 8", 0 TSRMLS_CC);
+        return;
+    }
+
+    try {
+        php_opencv_match_multiscale(cv::cvarrToMat(image_object->cvptr), cv::cvarrToMat(template_object->cvptr), mode,
+                scales, levels, threshold, max_count, margin < 0 ? 0 : margin, matches);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+
+    roi = cvGetImageROI(image_object->cvptr);
+    array_init(return_value);
+    for (i = 0; i < matches.size(); i++) {
+        MAKE_STD_ZVAL(temp);
+        array_init(temp);
+        add_assoc_long(temp, "x", matches[i].x + roi.x);
+        add_assoc_long(temp, "y", matches[i].y + roi.y);
+        add_assoc_long(temp, "width", matches[i].width);
+        add_assoc_long(temp, "height", matches[i].height);
+        add_assoc_double(temp, "score", matches[i].score);
+        add_assoc_double(temp, "scale", matches[i].scale);
+        add_next_index_zval(return_value, temp);
+    }
+}
+/* }}} */
+
+/* {{{ proto array findPeaks(float threshold [, int maxCount [, int nmsRadius [, bool minima]]])
+       Finds up to maxCount maxima (or minima) of a single-channel image such
+       as a matchTemplate() result, best first, as arrays of ('x', 'y',
+       'score'). Points within nmsRadius pixels of a better one are dropped.
+       Coordinates are relative to the image, not its ROI. */
+PHP_METHOD(OpenCV_Image, findPeaks)
+{
+    opencv_image_object *image_object;
+    zval *image_zval;
+    long max_count = 1, radius = 0;
+    double threshold;
+    zend_bool minima = 0;
+    CvRect roi;
+    std::vector<php_opencv_peak> peaks;
+    size_t i;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Od|llb", &image_zval, opencv_ce_image, &threshold, &max_count, &radius, &minima) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    if (image_object->cvptr->nChannels != 1) {
+        zend_throw_exception(opencv_ce_cvexception, "The image must have a single channel", 0 TSRMLS_CC);
+        return;
+    }
+
+    /* Suppression writes to the map, so work on a float copy */
+    try {
+        cv::Mat map_mat;
+        cv::cvarrToMat(image_object->cvptr).convertTo(map_mat, CV_32F);
+        php_opencv_find_peaks(map_mat, threshold, max_count, radius, minima, peaks);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+
+    roi = cvGetImageROI(image_object->cvptr);
+    for (i = 0; i < peaks.size(); i++) {
+        peaks[i].x += roi.x;
+        peaks[i].y += roi.y;
+    }
+    php_opencv_peaks_to_array(peaks, return_value);
+}
+/* }}} */
+
 PHP_METHOD(OpenCV_Image, rectangle)
 {
     opencv_image_object *image_object;
@@ -731,57 +1291,301 @@ PHP_METHOD(OpenCV_Image, rectangle)
 }
 /* }}} */
 
-/* {{{ */
+/* {{{ proto array haarDetectObjects(mixed cascade [, array options])
+       Accepts either a cascade filename or an OpenCV\CascadeClassifier. The
+       options are the same as for CascadeClassifier::detectMultiScale(). */
 PHP_METHOD(OpenCV_Image, haarDetectObjects)
 {
-    opencv_image_object *image_object, *dst_object;
-    zval *image_zval;
-    IplImage *grey_image;
-	const char *cascade_name;
-	int cascade_name_len, i;
-	CvHaarClassifierCascade *cascade;
-	CvMemStorage *storage = cvCreateMemStorage(0);
+    opencv_image_object *image_object;
+    opencv_cascade_object *cascade_object;
+    php_opencv_cascade_entry *entry;
+    php_opencv_haar_params params;
+    zval *image_zval, *cascade_zval, *options_zval = NULL;
 
     PHP_OPENCV_ERROR_HANDLING();
-    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Os", &image_zval, opencv_ce_image, &cascade_name, &cascade_name_len) == FAILURE) {
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Oz/|a", &image_zval, opencv_ce_image, &cascade_zval, &options_zval) == FAILURE) {
         PHP_OPENCV_RESTORE_ERRORS();
         return;
     }
     PHP_OPENCV_RESTORE_ERRORS();
 
-	cascade = (CvHaarClassifierCascade *) cvLoad(cascade_name, 0, 0, 0);
+    php_opencv_haar_params_init(&params, options_zval TSRMLS_CC);
+    if (EG(exception)) {
+        return;
+    }
 
     image_object = opencv_image_object_get(image_zval TSRMLS_CC);
-    if (image_object->cvptr->nChannels > 1) {
-        grey_image = cvCreateImage(cvGetSize(image_object->cvptr), IPL_DEPTH_8U, 1);
-        cvCvtColor(image_object->cvptr, grey_image, CV_BGR2GRAY);
+
+    if (Z_TYPE_P(cascade_zval) == IS_OBJECT && instanceof_function(Z_OBJCE_P(cascade_zval), opencv_ce_cascade TSRMLS_CC)) {
+        cascade_object = (opencv_cascade_object *) zend_object_store_get_object(cascade_zval TSRMLS_CC);
+        if (cascade_object->entry == NULL) {
+            zend_throw_exception(opencv_ce_cvexception, "The cascade classifier has not been loaded", 0 TSRMLS_CC);
+            return;
+        }
+        php_opencv_haar_detect(image_object->cvptr, cascade_object->entry, &params, return_value TSRMLS_CC);
     } else {
-        grey_image = image_object->cvptr;
+        convert_to_string(cascade_zval);
+        entry = php_opencv_cascade_acquire(Z_STRVAL_P(cascade_zval) TSRMLS_CC);
+        if (entry == NULL) {
+            return;
+        }
+        php_opencv_haar_detect(image_object->cvptr, entry, &params, return_value TSRMLS_CC);
+        php_opencv_cascade_release(entry);
     }
-	cvEqualizeHist(grey_image, grey_image);
-	cvClearMemStorage(storage);
-	#if ( (CV_MAJOR_VERSION >= 2) && (CV_MINOR_VERSION >= 3) )
-	CvSeq *objects = cvHaarDetectObjects(grey_image, cascade, storage, 1.1, 3, 0, cvSize(20, 20), cvSize(0, 0));
-	#else
-	CvSeq *objects = cvHaarDetectObjects(grey_image, cascade, storage, 1.1, 3, 0, cvSize(20, 20));
-	#endif
-	array_init(return_value);
-    for (i = 0; i < (objects ? objects->total : 0); i++) {
-		zval *temp;
-		CvRect *r = (CvRect *) cvGetSeqElem(objects, i);
-
-		MAKE_STD_ZVAL(temp);
-		array_init(temp);
-		add_assoc_long(temp, "x", r->x);
-		add_assoc_long(temp, "y", r->y);
-		add_assoc_long(temp, "width", r->width);
-		add_assoc_long(temp, "height", r->height);
 
-        add_next_index_zval(return_value, temp);
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* {{{ proto Image fromBytes(string data, int width, int height, int depth, int channels)
+       Creates an image from packed pixel data, such as from getBytes() */
+PHP_METHOD(OpenCV_Image, fromBytes) {
+    char *data;
+    int data_len;
+    long width, height, depth, channels;
+    uint64_t row_size;
+    IplImage *temp;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "sllll", &data, &data_len, &width, &height, &depth, &channels) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
     }
+    PHP_OPENCV_RESTORE_ERRORS();
 
-	//cvReleaseImage(grey_image);
-	php_opencv_throw_exception(TSRMLS_C);
+    if (width <= 0 || height <= 0 || width > INT_MAX || height > INT_MAX || !php_opencv_image_format_valid(depth, channels)) {
+        zend_throw_exception(opencv_ce_cvexception, "Invalid size, depth or channels for an image", 0 TSRMLS_CC);
+        return;
+    }
+
+    row_size = (uint64_t) width * channels * ((depth & 255) >> 3);
+    if ((uint64_t) data_len % row_size != 0 || (uint64_t) data_len / row_size != (uint64_t) height) {
+        zend_throw_exception(opencv_ce_cvexception, "The data length does not match the size, depth and channels", 0 TSRMLS_CC);
+        return;
+    }
+
+    temp = php_opencv_image_create(cvSize(width, height), depth, channels TSRMLS_CC);
+    if (temp == NULL) {
+        php_opencv_throw_exception(TSRMLS_C);
+        return;
+    }
+
+    try {
+        cv::Mat pixels = cv::cvarrToMat(temp);
+        php_opencv_mat_set_bytes(pixels, data, data_len, 0 TSRMLS_CC);
+    } catch (cv::Exception &e) {
+        php_opencv_image_release(&temp TSRMLS_CC);
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+
+    php_opencv_make_image_zval(temp, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto string getBytes([int startRow [, int rowCount]])
+       Returns the pixel data of the given rows, or the whole image, packed
+       without the padding at the end of each row. Only the ROI is copied if
+       one is set. */
+PHP_METHOD(OpenCV_Image, getBytes) {
+    opencv_image_object *image_object;
+    zval *image_zval;
+    long start_row = 0, row_count = -1;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O|ll", &image_zval, opencv_ce_image, &start_row, &row_count) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    try {
+        php_opencv_mat_get_bytes(cv::cvarrToMat(image_object->cvptr), start_row, row_count, return_value TSRMLS_CC);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+    }
+}
+/* }}} */
+
+/* {{{ proto void setBytes(string data [, int startRow])
+       Overwrites whole rows of the image, or its ROI if one is set, with
+       packed pixel data starting at startRow */
+PHP_METHOD(OpenCV_Image, setBytes) {
+    opencv_image_object *image_object;
+    zval *image_zval;
+    char *data;
+    int data_len;
+    long start_row = 0;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Os|l", &image_zval, opencv_ce_image, &data, &data_len, &start_row) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    try {
+        cv::Mat pixels = cv::cvarrToMat(image_object->cvptr);
+        php_opencv_mat_set_bytes(pixels, data, data_len, start_row TSRMLS_CC);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+    }
+}
+/* }}} */
+
+/* {{{ proto void saveRaw(string filename)
+       Saves the image, or its ROI, uncompressed with a small header so it
+       keeps its exact depth and can be mapped back in with loadMapped() */
+PHP_METHOD(OpenCV_Image, saveRaw) {
+    opencv_image_object *image_object;
+    zval *image_zval;
+    char *filename;
+    int filename_len;
+    php_opencv_raw_header header;
+    IplImage *image;
+    CvSize size;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Os", &image_zval, opencv_ce_image, &filename, &filename_len) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    image = image_object->cvptr;
+    size = cvGetSize(image);
+
+    php_opencv_raw_init(&header, PHP_OPENCV_RAW_IMAGE, size.width, size.height, image->depth, image->nChannels,
+            image->nChannels * ((image->depth & 255) >> 3));
+    header.origin = image->origin;
+
+    try {
+        php_opencv_raw_write_file(filename, &header, cv::cvarrToMat(image) TSRMLS_CC);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+    }
+}
+/* }}} */
+
+/* {{{ proto Image loadMapped(string filename)
+       Maps a file written by saveRaw() without reading or copying it. The
+       mapping is private: changes to the image are not written back. */
+PHP_METHOD(OpenCV_Image, loadMapped) {
+    char *filename;
+    int filename_len;
+    php_opencv_mapping *mapping;
+    opencv_image_object *image_object;
+    IplImage *image;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "s", &filename, &filename_len) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    mapping = php_opencv_raw_map_file(filename, PHP_OPENCV_RAW_IMAGE TSRMLS_CC);
+    if (mapping == NULL) {
+        return;
+    }
+
+    image = php_opencv_raw_image(mapping TSRMLS_CC);
+    if (image == NULL) {
+        php_opencv_mapping_release(mapping TSRMLS_CC);
+        return;
+    }
+    php_opencv_make_image_zval(image, return_value TSRMLS_CC);
+    image_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    php_opencv_image_set_backing(image_object, mapping, php_opencv_mapping_release TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto Mat toMat()
+       Returns a Mat sharing this image's pixels, or those of its ROI if one
+       is set. Changes through either object are seen by both, and the
+       image is kept alive for as long as the Mat is. */
+PHP_METHOD(OpenCV_Image, toMat) {
+    opencv_image_object *image_object;
+    opencv_mat_object *mat_object;
+    zval *image_zval;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O", &image_zval, opencv_ce_image) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+
+    try {
+        php_opencv_make_mat_zval(cv::cvarrToMat(image_object->cvptr), return_value TSRMLS_CC);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+
+    Z_ADDREF_P(image_zval);
+    mat_object = (opencv_mat_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    mat_object->backing = image_zval;
+    mat_object->release_backing = php_opencv_release_zval;
+}
+/* }}} */
+
+/* {{{ proto Image view(int x, int y, int width, int height)
+       Returns an image over a rectangle of this one's pixels, without
+       copying. Unlike setImageROI() each view is independent, so several
+       regions can be worked on at once. The rectangle is relative to the
+       whole image, and this image is kept alive while the view exists. */
+PHP_METHOD(OpenCV_Image, view) {
+    opencv_image_object *image_object, *view_object;
+    zval *image_zval;
+    long x, y, width, height;
+    IplImage *parent, *view;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ollll", &image_zval, opencv_ce_image, &x, &y, &width, &height) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    parent = image_object->cvptr;
+
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > parent->width || y + height > parent->height) {
+        zend_throw_exception(opencv_ce_cvexception, "The view must lie within the image", 0 TSRMLS_CC);
+        return;
+    }
+
+    view = cvCreateImageHeader(cvSize(width, height), parent->depth, parent->nChannels);
+    view->origin = parent->origin;
+    cvSetData(view, parent->imageData + y * parent->widthStep + x * parent->nChannels * ((parent->depth & 255) >> 3), parent->widthStep);
+
+    php_opencv_make_image_zval(view, return_value TSRMLS_CC);
+    Z_ADDREF_P(image_zval);
+    view_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    php_opencv_image_set_backing(view_object, image_zval, php_opencv_release_zval TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto array getPoolStats()
+       Returns how many released images the pool holds and how often
+       allocations were served from it */
+PHP_METHOD(OpenCV_Image, getPoolStats) {
+    if (zend_parse_parameters_none() == FAILURE) {
+        return;
+    }
+
+    array_init(return_value);
+    add_assoc_long(return_value, "images", OPENCV_G(image_pool_count));
+    add_assoc_long(return_value, "bytes", (long) OPENCV_G(image_pool_bytes));
+    add_assoc_long(return_value, "reused", (long) OPENCV_G(image_pool_hits));
+    add_assoc_long(return_value, "allocated", (long) OPENCV_G(image_pool_misses));
+    add_assoc_long(return_value, "freed", (long) OPENCV_G(image_pool_discards));
 }
 /* }}} */
 
@@ -790,6 +1594,17 @@ const zend_function_entry opencv_image_methods[] = {
     PHP_ME(OpenCV_Image, __construct, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
     PHP_ME(OpenCV_Image, load, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
     PHP_ME(OpenCV_Image, save, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, loadScaled, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Image, decode, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Image, encode, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, fromBytes, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Image, getBytes, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, setBytes, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, saveRaw, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, loadMapped, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Image, getPoolStats, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Image, toMat, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, view, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(OpenCV_Image, setImageROI, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(OpenCV_Image, getImageROI, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(OpenCV_Image, resetImageROI, NULL, ZEND_ACC_PUBLIC)
@@ -810,7 +1625,13 @@ const zend_function_entry opencv_image_methods[] = {
     PHP_ME(OpenCV_Image, split, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(OpenCV_Image, convertColor, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(OpenCV_Image, backProject, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, equalize, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(OpenCV_Image, matchTemplate, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, matchTemplateBest, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, matchTemplatePeaks, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, matchTemplateMultiScale, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, findPeaks, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Image, minMaxLoc, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(OpenCV_Image, haarDetectObjects, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(OpenCV_Image, rectangle, NULL, ZEND_ACC_PUBLIC)
     {NULL, NULL, NULL}
@@ -842,6 +1663,10 @@ PHP_MINIT_FUNCTION(opencv_image)
     REGISTER_IMAGE_LONG_CONST("LOAD_IMAGE_GRAYSCALE", CV_LOAD_IMAGE_GRAYSCALE);
     REGISTER_IMAGE_LONG_CONST("LOAD_IMAGE_UNCHANGED", CV_LOAD_IMAGE_UNCHANGED);
 
+    REGISTER_IMAGE_LONG_CONST("IMWRITE_JPEG_QUALITY", CV_IMWRITE_JPEG_QUALITY);
+    REGISTER_IMAGE_LONG_CONST("IMWRITE_PNG_COMPRESSION", CV_IMWRITE_PNG_COMPRESSION);
+    REGISTER_IMAGE_LONG_CONST("IMWRITE_PXM_BINARY", CV_IMWRITE_PXM_BINARY);
+
     REGISTER_IMAGE_LONG_CONST("BLUR_NO_SCALE", CV_BLUR_NO_SCALE);
     REGISTER_IMAGE_LONG_CONST("BLUR", CV_BLUR);
     REGISTER_IMAGE_LONG_CONST("GAUSSIAN", CV_GAUSSIAN);
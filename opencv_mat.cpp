@@ -27,24 +27,148 @@
 zend_class_entry *opencv_ce_cvmat;
 
 static inline opencv_mat_object* opencv_mat_object_get(zval *zobj TSRMLS_DC) {
-    opencv_mat_object *pobj = (opencv_mat_object *) zend_object_store_get_object(zobj TSRMLS_CC);
-    if (pobj->cvptr->empty()) {
+    opencv_mat_object *pobj;
+
+    /* Image extends Mat but keeps an IplImage in a different object struct,
+       so it can only reach the Mat methods it overrides */
+    if (instanceof_function(Z_OBJCE_P(zobj), opencv_ce_image TSRMLS_CC)) {
+        zend_throw_exception(opencv_ce_cvexception, "An OpenCV\\Image cannot be used where an OpenCV\\Mat is needed - use Image::toMat()", 0 TSRMLS_CC);
+        return NULL;
+    }
+
+    pobj = (opencv_mat_object *) zend_object_store_get_object(zobj TSRMLS_CC);
+    if (pobj->cvptr == NULL || pobj->cvptr->empty()) {
         php_error(E_ERROR, "Internal surface object missing in %s wrapper, you must call parent::__construct in extended classes", Z_OBJCE_P(zobj)->name);
     }
     return pobj;
 }
 
-#define PHP_OPENCV_ADD_MAT_LONG_PROPERTY(PROPERTY, MEMBER) \
-    do { \
-        zval *temp_prop; \
-        MAKE_STD_ZVAL(temp_prop); \
-        ZVAL_LONG(temp_prop, MEMBER); \
-        zend_hash_update(Z_OBJPROP_P(mat_zval), PROPERTY, sizeof(PROPERTY), (void **) &temp_prop, sizeof(zval *), NULL); \
-    } while(0)
+zend_object_handlers opencv_mat_object_handlers;
 
-/*
-PHP_OPENCV_API zval *php_opencv_make_mat_zval(Mat mat, zval *mat_zval TSRMLS_DC) {
-    zval *return_value, *width, *height;
+/* Mat and Image read their size and type straight from the native object
+   when asked, rather than copying them into the property table whenever an
+   object is made. This keeps them right after in-place operations too. */
+static const char *opencv_mat_property_names[] = {"cols", "rows", "channels", "depth", NULL};
+static const char *opencv_image_property_names[] = {"width", "height", "nChannels", "alphaChannel", "depth", NULL};
+
+/* Looks up a native property, returning FAILURE for ordinary properties
+   and for objects that have nothing wrapped yet */
+static int opencv_mat_native_property(zval *object, const char *name, long *value TSRMLS_DC)
+{
+    if (instanceof_function(Z_OBJCE_P(object), opencv_ce_image TSRMLS_CC)) {
+        IplImage *image = ((opencv_image_object *) zend_object_store_get_object(object TSRMLS_CC))->cvptr;
+
+        if (image == NULL) {
+            return FAILURE;
+        }
+        if (strcmp(name, "width") == 0) {
+            *value = image->width;
+        } else if (strcmp(name, "height") == 0) {
+            *value = image->height;
+        } else if (strcmp(name, "nChannels") == 0) {
+            *value = image->nChannels;
+        } else if (strcmp(name, "alphaChannel") == 0) {
+            *value = image->alphaChannel;
+        } else if (strcmp(name, "depth") == 0) {
+            *value = image->depth;
+        } else {
+            return FAILURE;
+        }
+    } else {
+        Mat *mat = ((opencv_mat_object *) zend_object_store_get_object(object TSRMLS_CC))->cvptr;
+
+        if (mat == NULL) {
+            return FAILURE;
+        }
+        if (strcmp(name, "cols") == 0) {
+            *value = mat->cols;
+        } else if (strcmp(name, "rows") == 0) {
+            *value = mat->rows;
+        } else if (strcmp(name, "channels") == 0) {
+            *value = mat->channels();
+        } else if (strcmp(name, "depth") == 0) {
+            *value = mat->depth();
+        } else {
+            return FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+static zval *opencv_mat_read_property(zval *object, zval *member, int type PHP_OPENCV_PROPERTY_KEY_DC TSRMLS_DC)
+{
+    zval *retval;
+    long value;
+
+    if (Z_TYPE_P(member) == IS_STRING && opencv_mat_native_property(object, Z_STRVAL_P(member), &value TSRMLS_CC) == SUCCESS) {
+        /* A temporary, owned by the engine once returned */
+        ALLOC_ZVAL(retval);
+        INIT_PZVAL(retval);
+        ZVAL_LONG(retval, value);
+        Z_SET_REFCOUNT_P(retval, 0);
+        return retval;
+    }
+    return zend_get_std_object_handlers()->read_property(object, member, type PHP_OPENCV_PROPERTY_KEY_CC TSRMLS_CC);
+}
+
+static void opencv_mat_write_property(zval *object, zval *member, zval *value PHP_OPENCV_PROPERTY_KEY_DC TSRMLS_DC)
+{
+    long current;
+
+    if (Z_TYPE_P(member) == IS_STRING && opencv_mat_native_property(object, Z_STRVAL_P(member), &current TSRMLS_CC) == SUCCESS) {
+        zend_throw_exception_ex(opencv_ce_cvexception, 0 TSRMLS_CC, "Cannot set %s::$%s, it is read-only", Z_OBJCE_P(object)->name, Z_STRVAL_P(member));
+        return;
+    }
+    zend_get_std_object_handlers()->write_property(object, member, value PHP_OPENCV_PROPERTY_KEY_CC TSRMLS_CC);
+}
+
+static int opencv_mat_has_property(zval *object, zval *member, int has_set_exists PHP_OPENCV_PROPERTY_KEY_DC TSRMLS_DC)
+{
+    long value;
+
+    if (Z_TYPE_P(member) == IS_STRING && opencv_mat_native_property(object, Z_STRVAL_P(member), &value TSRMLS_CC) == SUCCESS) {
+        /* 1 is empty(), which is true for zero; isset() and exists only
+           care that the property is there */
+        return has_set_exists == 1 ? value != 0 : 1;
+    }
+    return zend_get_std_object_handlers()->has_property(object, member, has_set_exists PHP_OPENCV_PROPERTY_KEY_CC TSRMLS_CC);
+}
+
+/* Returning NULL for the native properties makes the engine fall back to
+   read_property and write_property for things like $image->width++ */
+static zval **opencv_mat_get_property_ptr_ptr(zval *object, zval *member PHP_OPENCV_PROPERTY_PTR_DC TSRMLS_DC)
+{
+    long value;
+
+    if (Z_TYPE_P(member) == IS_STRING && opencv_mat_native_property(object, Z_STRVAL_P(member), &value TSRMLS_CC) == SUCCESS) {
+        return NULL;
+    }
+    return zend_get_std_object_handlers()->get_property_ptr_ptr(object, member PHP_OPENCV_PROPERTY_PTR_CC TSRMLS_CC);
+}
+
+/* var_dump(), foreach and array casts see the property table, so the
+   native values are copied in only when it is asked for */
+static HashTable *opencv_mat_get_properties(zval *object TSRMLS_DC)
+{
+    HashTable *properties = zend_std_get_properties(object TSRMLS_CC);
+    const char **names = instanceof_function(Z_OBJCE_P(object), opencv_ce_image TSRMLS_CC) ? opencv_image_property_names : opencv_mat_property_names;
+    zval *temp;
+    long value;
+    int i;
+
+    for (i = 0; names[i] != NULL; i++) {
+        if (opencv_mat_native_property(object, names[i], &value TSRMLS_CC) == SUCCESS) {
+            MAKE_STD_ZVAL(temp);
+            ZVAL_LONG(temp, value);
+            zend_hash_update(properties, names[i], strlen(names[i]) + 1, (void **) &temp, sizeof(zval *), NULL);
+        }
+    }
+    return properties;
+}
+
+/* Wraps a Mat in a new OpenCV\Mat object. The data is shared with mat,
+   not copied. */
+PHP_OPENCV_API zval *php_opencv_make_mat_zval(const Mat &mat, zval *mat_zval TSRMLS_DC) {
     opencv_mat_object *mat_obj;
 
     if (mat_zval == NULL) {
@@ -53,41 +177,24 @@ PHP_OPENCV_API zval *php_opencv_make_mat_zval(Mat mat, zval *mat_zval TSRMLS_DC)
 
     object_init_ex(mat_zval, opencv_ce_cvmat);
     mat_obj = (opencv_mat_object *) zend_object_store_get_object(mat_zval TSRMLS_CC);
-    mat_obj->cvptr = &mat;
-
-    PHP_OPENCV_ADD_MAT_LONG_PROPERTY("cols", mat.cols);
-    PHP_OPENCV_ADD_MAT_LONG_PROPERTY("rows", mat.rows);
-    PHP_OPENCV_ADD_MAT_LONG_PROPERTY("channels", mat.channels());
-//    PHP_OPENCV_ADD_MAT_LONG_PROPERTY("alphaChannel", mat.alphaChannel);
-    PHP_OPENCV_ADD_MAT_LONG_PROPERTY("depth", mat.depth());
+    mat_obj->cvptr = new Mat(mat);
 
     return mat_zval;
 }
-*/
-
-static void opencv_mat_object_assign_properties(zval *mat_zval TSRMLS_DC) {
-	opencv_mat_object *mat_obj;
-    mat_obj = (opencv_mat_object *) zend_object_store_get_object(mat_zval TSRMLS_CC);
-
-    PHP_OPENCV_ADD_MAT_LONG_PROPERTY("cols", mat_obj->cvptr->cols);
-    PHP_OPENCV_ADD_MAT_LONG_PROPERTY("rows", mat_obj->cvptr->rows);
-    PHP_OPENCV_ADD_MAT_LONG_PROPERTY("channels", mat_obj->cvptr->channels());
-//    PHP_OPENCV_ADD_MAT_LONG_PROPERTY("alphaChannel", mat_obj->cvptr.alphaChannel);
-    PHP_OPENCV_ADD_MAT_LONG_PROPERTY("depth", mat_obj->cvptr->depth());
-}
 
 void opencv_mat_object_destroy(void *object TSRMLS_DC)
 {
     opencv_mat_object *mat = (opencv_mat_object *)object;
-	//delete mat->cvptr;
+
     zend_hash_destroy(mat->std.properties);
     FREE_HASHTABLE(mat->std.properties);
 
-	/*
-    if(mat->cvptr != NULL){
-        cvRelease((void **) &mat->cvptr);
+    if (mat->cvptr != NULL) {
+        delete mat->cvptr;
+    }
+    if (mat->backing != NULL) {
+        mat->release_backing(mat->backing TSRMLS_CC);
     }
-	*/
     efree(mat);
 }
 
@@ -100,7 +207,7 @@ static zend_object_value opencv_mat_object_new(zend_class_entry *ce TSRMLS_DC)
     mat = (opencv_mat_object *) ecalloc(1, sizeof(opencv_mat_object));
 
     mat->std.ce = ce; 
-    //mat->cvptr = NULL;
+    mat->cvptr = NULL;
 
     ALLOC_HASHTABLE(mat->std.properties);
     zend_hash_init(mat->std.properties, 0, NULL, ZVAL_PTR_DTOR, 0); 
@@ -110,10 +217,84 @@ static zend_object_value opencv_mat_object_new(zend_class_entry *ce TSRMLS_DC)
     object_properties_init(&mat->std, ce);
 #endif
     retval.handle = zend_objects_store_put(mat, NULL, (zend_objects_free_object_storage_t)opencv_mat_object_destroy, NULL TSRMLS_CC);
-    retval.handlers = zend_get_std_object_handlers();
+    retval.handlers = &opencv_mat_object_handlers;
     return retval;
 }
 
+/* Checks a row range against a matrix, treating a negative count as "to
+   the last row" */
+static int php_opencv_mat_row_range(const cv::Mat &mat, long start_row, long *row_count TSRMLS_DC)
+{
+    if (*row_count < 0) {
+        *row_count = mat.rows - start_row;
+    }
+    if (start_row < 0 || start_row > mat.rows || *row_count > mat.rows - start_row) {
+        zend_throw_exception(opencv_ce_cvexception, "The row range is outside the image", 0 TSRMLS_CC);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* {{{ php_opencv_mat_get_bytes
+   Returns a range of rows as a string of packed pixel data, without any
+   padding at the end of each row */
+PHP_OPENCV_API void php_opencv_mat_get_bytes(const cv::Mat &mat, long start_row, long row_count, zval *return_value TSRMLS_DC)
+{
+    size_t row_size = mat.cols * mat.elemSize(), length;
+    char *buffer;
+    long i;
+
+    if (php_opencv_mat_row_range(mat, start_row, &row_count TSRMLS_CC) == FAILURE) {
+        return;
+    }
+
+    length = row_size * row_count;
+    buffer = (char *) emalloc(length + 1);
+    if (length == 0) {
+        /* Nothing to copy */
+    } else if (mat.isContinuous()) {
+        memcpy(buffer, mat.ptr(start_row), length);
+    } else {
+        for (i = 0; i < row_count; i++) {
+            memcpy(buffer + i * row_size, mat.ptr(start_row + i), row_size);
+        }
+    }
+    buffer[length] = '\0';
+
+    RETURN_STRINGL(buffer, length, 0);
+}
+/* }}} */
+
+/* {{{ php_opencv_mat_set_bytes
+   Copies packed pixel data over whole rows, starting at start_row */
+PHP_OPENCV_API int php_opencv_mat_set_bytes(cv::Mat &mat, const char *data, int data_len, long start_row TSRMLS_DC)
+{
+    size_t row_size = mat.cols * mat.elemSize();
+    long row_count, i;
+
+    if (row_size == 0 || data_len % row_size != 0) {
+        zend_throw_exception(opencv_ce_cvexception, "The data must be a whole number of rows", 0 TSRMLS_CC);
+        return FAILURE;
+    }
+
+    row_count = data_len / row_size;
+    if (php_opencv_mat_row_range(mat, start_row, &row_count TSRMLS_CC) == FAILURE) {
+        return FAILURE;
+    }
+
+    if (row_count == 0) {
+        return SUCCESS;
+    } else if (mat.isContinuous()) {
+        memcpy(mat.ptr(start_row), data, data_len);
+    } else {
+        for (i = 0; i < row_count; i++) {
+            memcpy(mat.ptr(start_row + i), data + i * row_size, row_size);
+        }
+    }
+    return SUCCESS;
+}
+/* }}} */
+
 /* {{{ proto void contruct()
    OpenCV_Mat CANNOT be extended in userspace, this will throw an exception on use */
 PHP_METHOD(OpenCV_Mat, __construct)
@@ -130,7 +311,6 @@ PHP_METHOD(OpenCV_Mat, __construct)
 
     object = (opencv_mat_object *) zend_object_store_get_object(getThis() TSRMLS_CC);
     object->cvptr = new Mat(rows, cols, type);
-	opencv_mat_object_assign_properties(getThis() TSRMLS_CC);
     php_opencv_throw_exception(TSRMLS_C);
 }
 /* }}} */
@@ -164,7 +344,6 @@ PHP_METHOD(OpenCV_Mat, load) {
 
 	// I'm sure there's a neater way to do this
 	mat_obj->cvptr = new Mat(temp);
-	opencv_mat_object_assign_properties(return_value TSRMLS_CC);
 
     php_opencv_throw_exception(TSRMLS_C);
 }
@@ -185,6 +364,9 @@ PHP_METHOD(OpenCV_Mat, save) {
     PHP_OPENCV_RESTORE_ERRORS();
 
     mat_object = opencv_mat_object_get(getThis() TSRMLS_CC);
+    if (mat_object == NULL) {
+        return;
+    }
     cast_mode = mode;
     status = imwrite(filename, *mat_object->cvptr);
     php_opencv_throw_exception(TSRMLS_C);
@@ -194,11 +376,594 @@ PHP_METHOD(OpenCV_Mat, save) {
     }
 }
 
+/* {{{ proto Mat decode(string bytes [, int mode])
+       Decodes an image held in memory into a new Mat */
+PHP_METHOD(OpenCV_Mat, decode) {
+    char *bytes;
+    int bytes_len;
+    long mode = CV_LOAD_IMAGE_COLOR;
+    opencv_mat_object *mat_obj;
+    Mat temp;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "s|l", &bytes, &bytes_len, &mode) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    try {
+        temp = imdecode(Mat(1, bytes_len, CV_8UC1, bytes), mode);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+
+    if (temp.empty()) {
+        zend_throw_exception(opencv_ce_cvexception, "Could not decode the image - check the data is complete and the codec is available", 0 TSRMLS_CC);
+        return;
+    }
+
+    object_init_ex(return_value, opencv_ce_cvmat);
+    mat_obj = (opencv_mat_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    mat_obj->cvptr = new Mat(temp);
+}
+/* }}} */
+
+/* {{{ proto string encode(string ext [, array params])
+       Encodes the Mat into a string using the codec for the given extension */
+PHP_METHOD(OpenCV_Mat, encode) {
+    opencv_mat_object *mat_object;
+    zval *mat_zval, *params_zval = NULL;
+    char *ext;
+    int ext_len;
+    std::vector<int> params;
+    std::vector<uchar> buffer;
+    std::string full_ext;
+    bool status;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Os|a", &mat_zval, opencv_ce_cvmat, &ext, &ext_len, &params_zval) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    mat_object = opencv_mat_object_get(mat_zval TSRMLS_CC);
+    if (mat_object == NULL) {
+        return;
+    }
+    php_opencv_array_to_params(params_zval, params TSRMLS_CC);
+
+    /* Accept both "jpg" and ".jpg" */
+    full_ext.assign(ext, ext_len);
+    if (ext_len > 0 && ext[0] != '.') {
+        full_ext.insert(0, ".");
+    }
+
+    try {
+        status = imencode(full_ext, *mat_object->cvptr, buffer, params);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+
+    if (!status) {
+        zend_throw_exception(opencv_ce_cvexception, "Failed to encode image", 0 TSRMLS_CC);
+        return;
+    }
+
+    RETURN_STRINGL(buffer.empty() ? (char *) "" : (char *) &buffer[0], buffer.size(), 1);
+}
+/* }}} */
+
+/* {{{ proto Mat fromBytes(string data, int rows, int cols, int type)
+       Creates a Mat from packed pixel data, such as from getBytes() */
+PHP_METHOD(OpenCV_Mat, fromBytes) {
+    char *data;
+    int data_len;
+    long rows, cols, type;
+    opencv_mat_object *mat_obj;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "slll", &data, &data_len, &rows, &cols, &type) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    if (rows <= 0 || cols <= 0 || (size_t) data_len != rows * cols * CV_ELEM_SIZE(type)) {
+        zend_throw_exception(opencv_ce_cvexception, "The data length does not match the size and type", 0 TSRMLS_CC);
+        return;
+    }
+
+    object_init_ex(return_value, opencv_ce_cvmat);
+    mat_obj = (opencv_mat_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    try {
+        mat_obj->cvptr = new Mat(rows, cols, type);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+    memcpy(mat_obj->cvptr->data, data, data_len);
+}
+/* }}} */
+
+/* {{{ proto string getBytes([int startRow [, int rowCount]])
+       Returns the pixel data of the given rows, or the whole Mat, packed
+       without row padding */
+PHP_METHOD(OpenCV_Mat, getBytes) {
+    opencv_mat_object *mat_object;
+    zval *mat_zval;
+    long start_row = 0, row_count = -1;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O|ll", &mat_zval, opencv_ce_cvmat, &start_row, &row_count) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    mat_object = opencv_mat_object_get(mat_zval TSRMLS_CC);
+    if (mat_object == NULL) {
+        return;
+    }
+    php_opencv_mat_get_bytes(*mat_object->cvptr, start_row, row_count, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto void setBytes(string data [, int startRow])
+       Overwrites whole rows with packed pixel data, starting at startRow */
+PHP_METHOD(OpenCV_Mat, setBytes) {
+    opencv_mat_object *mat_object;
+    zval *mat_zval;
+    char *data;
+    int data_len;
+    long start_row = 0;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Os|l", &mat_zval, opencv_ce_cvmat, &data, &data_len, &start_row) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    mat_object = opencv_mat_object_get(mat_zval TSRMLS_CC);
+    if (mat_object == NULL) {
+        return;
+    }
+    php_opencv_mat_set_bytes(*mat_object->cvptr, data, data_len, start_row TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto void saveRaw(string filename)
+       Saves the Mat uncompressed with a small header, so it can be mapped
+       straight back in with loadMapped() */
+PHP_METHOD(OpenCV_Mat, saveRaw) {
+    opencv_mat_object *mat_object;
+    zval *mat_zval;
+    char *filename;
+    int filename_len;
+    php_opencv_raw_header header;
+    Mat *mat;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Os", &mat_zval, opencv_ce_cvmat, &filename, &filename_len) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    mat_object = opencv_mat_object_get(mat_zval TSRMLS_CC);
+    if (mat_object == NULL) {
+        return;
+    }
+    mat = mat_object->cvptr;
+
+    php_opencv_raw_init(&header, PHP_OPENCV_RAW_MAT, mat->cols, mat->rows, mat->type(), mat->channels(), mat->elemSize());
+    php_opencv_raw_write_file(filename, &header, *mat TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto Mat loadMapped(string filename)
+       Maps a file written by saveRaw() without reading or copying it. The
+       mapping is private: changes to the Mat are not written back. */
+PHP_METHOD(OpenCV_Mat, loadMapped) {
+    char *filename;
+    int filename_len;
+    php_opencv_mapping *mapping;
+    php_opencv_raw_header *header;
+    opencv_mat_object *mat_obj;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "s", &filename, &filename_len) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    mapping = php_opencv_raw_map_file(filename, PHP_OPENCV_RAW_MAT TSRMLS_CC);
+    if (mapping == NULL) {
+        return;
+    }
+    header = (php_opencv_raw_header *) mapping->addr;
+
+    object_init_ex(return_value, opencv_ce_cvmat);
+    mat_obj = (opencv_mat_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    mat_obj->backing = mapping;
+    mat_obj->release_backing = php_opencv_mapping_release;
+    try {
+        mat_obj->cvptr = new Mat(header->height, header->width, header->depth, (char *) mapping->addr + header->data_offset, header->row_size);
+    } catch (cv::Exception &e) {
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return;
+    }
+}
+/* }}} */
+
+/* Parses the object and an optional destination Mat for the operations
+   below. The result goes into dst when one is given, reallocating it only
+   if its size or type doesn't match, and into a new Mat otherwise. */
+#define PHP_OPENCV_MAT_OP_BEGIN() \
+    opencv_mat_object *mat_object; \
+    zval *mat_zval, *dst_zval = NULL; \
+    Mat *dst;
+
+static Mat *php_opencv_mat_op_dst(zval *dst_zval, zval *return_value TSRMLS_DC)
+{
+    opencv_mat_object *dst_object;
+
+    if (dst_zval != NULL) {
+        dst_object = opencv_mat_object_get(dst_zval TSRMLS_CC);
+        if (dst_object == NULL) {
+            return NULL;
+        }
+        RETVAL_ZVAL(dst_zval, 1, 0);
+        return dst_object->cvptr;
+    }
+
+    object_init_ex(return_value, opencv_ce_cvmat);
+    dst_object = (opencv_mat_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    dst_object->cvptr = new Mat();
+    return dst_object->cvptr;
+}
+
+/* Runs a cv:: call, turning OpenCV errors into exceptions and refreshing
+   the result's properties */
+#define PHP_OPENCV_MAT_OP_RUN(call) \
+    mat_object = opencv_mat_object_get(mat_zval TSRMLS_CC); \
+    if (mat_object == NULL) { \
+        return; \
+    } \
+    dst = php_opencv_mat_op_dst(dst_zval, return_value TSRMLS_CC); \
+    if (dst == NULL) { \
+        return; \
+    } \
+    try { \
+        call; \
+    } catch (cv::Exception &e) { \
+        php_opencv_throw_cv_exception(e TSRMLS_CC); \
+        return; \
+    } \
+
+/* {{{ proto Mat resize(int width, int height [, int interpolation [, Mat dst]]) */
+PHP_METHOD(OpenCV_Mat, resize) {
+    PHP_OPENCV_MAT_OP_BEGIN();
+    long width, height, interpolation = INTER_LINEAR;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Oll|lO!", &mat_zval, opencv_ce_cvmat, &width, &height, &interpolation, &dst_zval, opencv_ce_cvmat) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    PHP_OPENCV_MAT_OP_RUN(cv::resize(*mat_object->cvptr, *dst, cv::Size(width, height), 0, 0, interpolation));
+}
+/* }}} */
+
+/* {{{ proto Mat cvtColor(int code [, int channels [, Mat dst]])
+       Takes the same conversion codes as Image::convertColor() */
+PHP_METHOD(OpenCV_Mat, cvtColor) {
+    PHP_OPENCV_MAT_OP_BEGIN();
+    long code, channels = 0;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|lO!", &mat_zval, opencv_ce_cvmat, &code, &channels, &dst_zval, opencv_ce_cvmat) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    PHP_OPENCV_MAT_OP_RUN(cv::cvtColor(*mat_object->cvptr, *dst, code, channels));
+}
+/* }}} */
+
+/* {{{ proto Mat blur(int kernelWidth, int kernelHeight [, Mat dst]) */
+PHP_METHOD(OpenCV_Mat, blur) {
+    PHP_OPENCV_MAT_OP_BEGIN();
+    long kernel_width, kernel_height;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Oll|O!", &mat_zval, opencv_ce_cvmat, &kernel_width, &kernel_height, &dst_zval, opencv_ce_cvmat) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    PHP_OPENCV_MAT_OP_RUN(cv::blur(*mat_object->cvptr, *dst, cv::Size(kernel_width, kernel_height)));
+}
+/* }}} */
+
+/* {{{ proto Mat gaussianBlur(int kernelWidth, int kernelHeight [, float sigmaX [, float sigmaY [, Mat dst]]]) */
+PHP_METHOD(OpenCV_Mat, gaussianBlur) {
+    PHP_OPENCV_MAT_OP_BEGIN();
+    long kernel_width, kernel_height;
+    double sigma_x = 0, sigma_y = 0;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Oll|ddO!", &mat_zval, opencv_ce_cvmat, &kernel_width, &kernel_height, &sigma_x, &sigma_y, &dst_zval, opencv_ce_cvmat) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    PHP_OPENCV_MAT_OP_RUN(cv::GaussianBlur(*mat_object->cvptr, *dst, cv::Size(kernel_width, kernel_height), sigma_x, sigma_y));
+}
+/* }}} */
+
+/* {{{ proto Mat medianBlur(int kernelSize [, Mat dst]) */
+PHP_METHOD(OpenCV_Mat, medianBlur) {
+    PHP_OPENCV_MAT_OP_BEGIN();
+    long kernel_size;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|O!", &mat_zval, opencv_ce_cvmat, &kernel_size, &dst_zval, opencv_ce_cvmat) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    PHP_OPENCV_MAT_OP_RUN(cv::medianBlur(*mat_object->cvptr, *dst, kernel_size));
+}
+/* }}} */
+
+/* {{{ proto Mat threshold(float threshold, float maxValue, int type [, Mat dst]) */
+PHP_METHOD(OpenCV_Mat, threshold) {
+    PHP_OPENCV_MAT_OP_BEGIN();
+    double thresh, max_value;
+    long type;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Oddl|O!", &mat_zval, opencv_ce_cvmat, &thresh, &max_value, &type, &dst_zval, opencv_ce_cvmat) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    PHP_OPENCV_MAT_OP_RUN(cv::threshold(*mat_object->cvptr, *dst, thresh, max_value, type));
+}
+/* }}} */
+
+/* {{{ proto Mat morphologyEx(int operation [, int iterations [, int kernelSize [, Mat dst]]])
+       Applies one of the MORPH_* operations with a square kernel */
+PHP_METHOD(OpenCV_Mat, morphologyEx) {
+    PHP_OPENCV_MAT_OP_BEGIN();
+    long operation, iterations = 1, kernel_size = 3;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|llO!", &mat_zval, opencv_ce_cvmat, &operation, &iterations, &kernel_size, &dst_zval, opencv_ce_cvmat) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    PHP_OPENCV_MAT_OP_RUN(cv::morphologyEx(*mat_object->cvptr, *dst, operation,
+            cv::getStructuringElement(cv::MORPH_RECT, cv::Size(kernel_size, kernel_size)), cv::Point(-1, -1), iterations));
+}
+/* }}} */
+
+/* Erosion and dilation are the simple cases of morphologyEx */
+#define PHP_OPENCV_MAT_MORPH_METHOD(name, operation) \
+PHP_METHOD(OpenCV_Mat, name) { \
+    PHP_OPENCV_MAT_OP_BEGIN(); \
+    long iterations = 1, kernel_size = 3; \
+\
+    PHP_OPENCV_ERROR_HANDLING(); \
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O|llO!", &mat_zval, opencv_ce_cvmat, &iterations, &kernel_size, &dst_zval, opencv_ce_cvmat) == FAILURE) { \
+        PHP_OPENCV_RESTORE_ERRORS(); \
+        return; \
+    } \
+    PHP_OPENCV_RESTORE_ERRORS(); \
+\
+    PHP_OPENCV_MAT_OP_RUN(cv::morphologyEx(*mat_object->cvptr, *dst, operation, \
+            cv::getStructuringElement(cv::MORPH_RECT, cv::Size(kernel_size, kernel_size)), cv::Point(-1, -1), iterations)); \
+}
+
+/* {{{ proto Mat erode([int iterations [, int kernelSize [, Mat dst]]]) */
+PHP_OPENCV_MAT_MORPH_METHOD(erode, cv::MORPH_ERODE)
+/* }}} */
+
+/* {{{ proto Mat dilate([int iterations [, int kernelSize [, Mat dst]]]) */
+PHP_OPENCV_MAT_MORPH_METHOD(dilate, cv::MORPH_DILATE)
+/* }}} */
+
+/* Element-wise operations on two Mats of the same size and type */
+#define PHP_OPENCV_MAT_ARITH_METHOD(name, func) \
+PHP_METHOD(OpenCV_Mat, name) { \
+    PHP_OPENCV_MAT_OP_BEGIN(); \
+    opencv_mat_object *other_object; \
+    zval *other_zval; \
+\
+    PHP_OPENCV_ERROR_HANDLING(); \
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "OO|O!", &mat_zval, opencv_ce_cvmat, &other_zval, opencv_ce_cvmat, &dst_zval, opencv_ce_cvmat) == FAILURE) { \
+        PHP_OPENCV_RESTORE_ERRORS(); \
+        return; \
+    } \
+    PHP_OPENCV_RESTORE_ERRORS(); \
+\
+    other_object = opencv_mat_object_get(other_zval TSRMLS_CC); \
+    if (other_object == NULL) { \
+        return; \
+    } \
+    PHP_OPENCV_MAT_OP_RUN(func(*mat_object->cvptr, *other_object->cvptr, *dst)); \
+}
+
+/* {{{ proto Mat add(Mat other [, Mat dst])
+       Saturating per-element sum */
+PHP_OPENCV_MAT_ARITH_METHOD(add, cv::add)
+/* }}} */
+
+/* {{{ proto Mat subtract(Mat other [, Mat dst])
+       Saturating per-element difference */
+PHP_OPENCV_MAT_ARITH_METHOD(subtract, cv::subtract)
+/* }}} */
+
+/* {{{ proto Mat absdiff(Mat other [, Mat dst])
+       Per-element absolute difference */
+PHP_OPENCV_MAT_ARITH_METHOD(absdiff, cv::absdiff)
+/* }}} */
+
+/* {{{ proto Mat convertTo(int type [, float alpha [, float beta [, Mat dst]]])
+       Converts to another depth, computing value * alpha + beta */
+PHP_METHOD(OpenCV_Mat, convertTo) {
+    PHP_OPENCV_MAT_OP_BEGIN();
+    long type;
+    double alpha = 1, beta = 0;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ol|ddO!", &mat_zval, opencv_ce_cvmat, &type, &alpha, &beta, &dst_zval, opencv_ce_cvmat) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    PHP_OPENCV_MAT_OP_RUN(mat_object->cvptr->convertTo(*dst, type, alpha, beta));
+}
+/* }}} */
+
+/* What an image made by Mat::toImage() holds on to: a reference to the
+   pixel data itself, in case the Mat is later reallocated, and the Mat
+   object, which may own the memory the data lives in */
+typedef struct _php_opencv_mat_ref {
+    Mat *mat;
+    zval *owner;
+} php_opencv_mat_ref;
+
+static void php_opencv_mat_ref_release(void *backing TSRMLS_DC)
+{
+    php_opencv_mat_ref *ref = (php_opencv_mat_ref *) backing;
+
+    delete ref->mat;
+    zval_ptr_dtor(&ref->owner);
+    efree(ref);
+}
+
+/* {{{ proto Image toImage()
+       Returns an Image sharing this Mat's pixels. Changes through either
+       object are seen by both. */
+PHP_METHOD(OpenCV_Mat, toImage) {
+    opencv_mat_object *mat_object;
+    opencv_image_object *image_object;
+    php_opencv_mat_ref *ref;
+    zval *mat_zval;
+    IplImage *image;
+    Mat *mat;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O", &mat_zval, opencv_ce_cvmat) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    mat_object = opencv_mat_object_get(mat_zval TSRMLS_CC);
+    if (mat_object == NULL) {
+        return;
+    }
+    mat = mat_object->cvptr;
+
+    if (mat->dims > 2 || mat->channels() > 4) {
+        zend_throw_exception(opencv_ce_cvexception, "Only 2D Mats with up to 4 channels can be used as an Image", 0 TSRMLS_CC);
+        return;
+    }
+
+    image = cvCreateImageHeader(cvSize(mat->cols, mat->rows), cvIplDepth(mat->type()), mat->channels());
+    cvSetData(image, mat->data, (int) mat->step[0]);
+
+    ref = (php_opencv_mat_ref *) emalloc(sizeof(php_opencv_mat_ref));
+    ref->mat = new Mat(*mat);
+    ref->owner = mat_zval;
+    Z_ADDREF_P(mat_zval);
+
+    php_opencv_make_image_zval(image, return_value TSRMLS_CC);
+    image_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    php_opencv_image_set_backing(image_object, ref, php_opencv_mat_ref_release TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto Mat roi(int x, int y, int width, int height)
+       Returns a Mat over a rectangle of this one's elements, without
+       copying. This Mat is kept alive while the region exists. */
+PHP_METHOD(OpenCV_Mat, roi) {
+    opencv_mat_object *mat_object, *roi_object;
+    zval *mat_zval;
+    long x, y, width, height;
+    Mat *mat;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "Ollll", &mat_zval, opencv_ce_cvmat, &x, &y, &width, &height) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    mat_object = opencv_mat_object_get(mat_zval TSRMLS_CC);
+    if (mat_object == NULL) {
+        return;
+    }
+    mat = mat_object->cvptr;
+
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > mat->cols || y + height > mat->rows) {
+        zend_throw_exception(opencv_ce_cvexception, "The region must lie within the Mat", 0 TSRMLS_CC);
+        return;
+    }
+
+    php_opencv_make_mat_zval((*mat)(cv::Rect(x, y, width, height)), return_value TSRMLS_CC);
+    Z_ADDREF_P(mat_zval);
+    roi_object = (opencv_mat_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    roi_object->backing = mat_zval;
+    roi_object->release_backing = php_opencv_release_zval;
+}
+/* }}} */
+
 /* {{{ opencv_mat_methods[] */
 const zend_function_entry opencv_mat_methods[] = { 
     PHP_ME(OpenCV_Mat, __construct, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
     PHP_ME(OpenCV_Mat, load, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
     PHP_ME(OpenCV_Mat, save, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, decode, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Mat, encode, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, fromBytes, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Mat, getBytes, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, setBytes, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, saveRaw, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, loadMapped, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Mat, resize, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, cvtColor, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, blur, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, gaussianBlur, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, medianBlur, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, threshold, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, erode, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, dilate, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, morphologyEx, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, add, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, subtract, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, absdiff, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, convertTo, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, toImage, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Mat, roi, NULL, ZEND_ACC_PUBLIC)
     {NULL, NULL, NULL}
 };
 /* }}} */
@@ -210,6 +975,50 @@ PHP_MINIT_FUNCTION(opencv_mat)
 	
     INIT_NS_CLASS_ENTRY(ce, "OpenCV", "Mat", opencv_mat_methods);
 	opencv_ce_cvmat = zend_register_internal_class(&ce TSRMLS_CC);
+	opencv_ce_cvmat->create_object = opencv_mat_object_new;
+
+    memcpy(&opencv_mat_object_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    opencv_mat_object_handlers.read_property = opencv_mat_read_property;
+    opencv_mat_object_handlers.write_property = opencv_mat_write_property;
+    opencv_mat_object_handlers.has_property = opencv_mat_has_property;
+    opencv_mat_object_handlers.get_property_ptr_ptr = opencv_mat_get_property_ptr_ptr;
+    opencv_mat_object_handlers.get_properties = opencv_mat_get_properties;
+
+    /* Class constants only; the matching CV_* globals are registered by
+       OpenCV\Image where they exist */
+	#define REGISTER_MAT_LONG_CONST(const_name, value) \
+	zend_declare_class_constant_long(opencv_ce_cvmat, const_name, sizeof(const_name)-1, (long)value TSRMLS_CC);
+
+    REGISTER_MAT_LONG_CONST("TYPE_8UC1", CV_8UC1);
+    REGISTER_MAT_LONG_CONST("TYPE_8UC3", CV_8UC3);
+    REGISTER_MAT_LONG_CONST("TYPE_8UC4", CV_8UC4);
+    REGISTER_MAT_LONG_CONST("TYPE_16SC1", CV_16SC1);
+    REGISTER_MAT_LONG_CONST("TYPE_16UC1", CV_16UC1);
+    REGISTER_MAT_LONG_CONST("TYPE_32SC1", CV_32SC1);
+    REGISTER_MAT_LONG_CONST("TYPE_32FC1", CV_32FC1);
+    REGISTER_MAT_LONG_CONST("TYPE_32FC3", CV_32FC3);
+    REGISTER_MAT_LONG_CONST("TYPE_64FC1", CV_64FC1);
+
+    REGISTER_MAT_LONG_CONST("INTER_NEAREST", INTER_NEAREST);
+    REGISTER_MAT_LONG_CONST("INTER_LINEAR", INTER_LINEAR);
+    REGISTER_MAT_LONG_CONST("INTER_CUBIC", INTER_CUBIC);
+    REGISTER_MAT_LONG_CONST("INTER_AREA", INTER_AREA);
+    REGISTER_MAT_LONG_CONST("INTER_LANCZOS4", INTER_LANCZOS4);
+
+    REGISTER_MAT_LONG_CONST("THRESH_BINARY", THRESH_BINARY);
+    REGISTER_MAT_LONG_CONST("THRESH_BINARY_INV", THRESH_BINARY_INV);
+    REGISTER_MAT_LONG_CONST("THRESH_TRUNC", THRESH_TRUNC);
+    REGISTER_MAT_LONG_CONST("THRESH_TOZERO", THRESH_TOZERO);
+    REGISTER_MAT_LONG_CONST("THRESH_TOZERO_INV", THRESH_TOZERO_INV);
+    REGISTER_MAT_LONG_CONST("THRESH_OTSU", THRESH_OTSU);
+
+    REGISTER_MAT_LONG_CONST("MORPH_ERODE", MORPH_ERODE);
+    REGISTER_MAT_LONG_CONST("MORPH_DILATE", MORPH_DILATE);
+    REGISTER_MAT_LONG_CONST("MORPH_OPEN", MORPH_OPEN);
+    REGISTER_MAT_LONG_CONST("MORPH_CLOSE", MORPH_CLOSE);
+    REGISTER_MAT_LONG_CONST("MORPH_GRADIENT", MORPH_GRADIENT);
+    REGISTER_MAT_LONG_CONST("MORPH_TOPHAT", MORPH_TOPHAT);
+    REGISTER_MAT_LONG_CONST("MORPH_BLACKHAT", MORPH_BLACKHAT);
 
 	return SUCCESS;
 }
@@ -0,0 +1,226 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 5                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2010 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Author: Michael Maclean <mgdm@php.net>                               |
+  +----------------------------------------------------------------------+
+*/
+
+/* $Id$ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+#include "php_opencv.h"
+
+#include <float.h>
+#include <algorithm>
+
+/* Whether smaller scores are better for the given matchTemplate mode */
+PHP_OPENCV_API int php_opencv_match_minimises(int mode)
+{
+    return mode == CV_TM_SQDIFF || mode == CV_TM_SQDIFF_NORMED;
+}
+
+/* Finds up to max_count local extremes of a single-channel response map
+   that pass the threshold, best first. After each one is taken, everything
+   within radius of it is suppressed so neighbouring pixels of the same
+   match aren't reported again. This overwrites the map. */
+PHP_OPENCV_API void php_opencv_find_peaks(cv::Mat &map, double threshold, int max_count, int radius, bool minima, std::vector<php_opencv_peak> &peaks)
+{
+    double min_val, max_val, score;
+    cv::Point min_loc, max_loc, loc;
+    cv::Rect bounds(0, 0, map.cols, map.rows), suppress;
+    php_opencv_peak peak;
+
+    if (radius < 0) {
+        radius = 0;
+    }
+
+    while ((int) peaks.size() < max_count) {
+        cv::minMaxLoc(map, &min_val, &max_val, &min_loc, &max_loc);
+        score = minima ? min_val : max_val;
+        loc = minima ? min_loc : max_loc;
+
+        /* Suppressed pixels are set to the worst possible score */
+        if (minima ? (score > threshold || score >= FLT_MAX) : (score < threshold || score <= -FLT_MAX)) {
+            break;
+        }
+
+        peak.x = loc.x;
+        peak.y = loc.y;
+        peak.score = score;
+        peaks.push_back(peak);
+
+        suppress = cv::Rect(loc.x - radius, loc.y - radius, radius * 2 + 1, radius * 2 + 1) & bounds;
+        map(suppress).setTo(cv::Scalar(minima ? FLT_MAX : -FLT_MAX));
+    }
+}
+
+/* Converts peaks to an array of array('x' => int, 'y' => int, 'score' => float) */
+PHP_OPENCV_API void php_opencv_peaks_to_array(const std::vector<php_opencv_peak> &peaks, zval *return_value)
+{
+    zval *temp;
+    size_t i;
+
+    array_init(return_value);
+    for (i = 0; i < peaks.size(); i++) {
+        MAKE_STD_ZVAL(temp);
+        array_init(temp);
+        add_assoc_long(temp, "x", peaks[i].x);
+        add_assoc_long(temp, "y", peaks[i].y);
+        add_assoc_double(temp, "score", peaks[i].score);
+        add_next_index_zval(return_value, temp);
+    }
+}
+
+/* The smallest template side worth matching at a reduced pyramid level */
+#define PHP_OPENCV_MATCH_MIN_SIZE 8
+
+/* How many coarse candidates to refine for each match asked for */
+#define PHP_OPENCV_MATCH_CANDIDATES 4
+
+static bool php_opencv_match_better(const php_opencv_match &a, const php_opencv_match &b)
+{
+    return a.score > b.score;
+}
+
+static bool php_opencv_match_lower(const php_opencv_match &a, const php_opencv_match &b)
+{
+    return a.score < b.score;
+}
+
+/* Whether two hits cover mostly the same area */
+static bool php_opencv_match_overlaps(const php_opencv_match &a, const php_opencv_match &b)
+{
+    cv::Rect ra(a.x, a.y, a.width, a.height), rb(b.x, b.y, b.width, b.height);
+    int overlap = (ra & rb).area();
+
+    return overlap * 2 > std::min(ra.area(), rb.area());
+}
+
+/* Matches a template against the image at each of the given scales,
+   coarse to fine: the template is first searched for in a pyrDown level of
+   the image, then only the area around each candidate is searched again at
+   full resolution. Hits scoring worse than the threshold are dropped, and
+   the rest are ranked with overlapping hits removed. */
+PHP_OPENCV_API void php_opencv_match_multiscale(const cv::Mat &image, const cv::Mat &templ, int mode, const std::vector<double> &scales, int levels, double threshold, int max_count, int margin, std::vector<php_opencv_match> &matches)
+{
+    bool minima = php_opencv_match_minimises(mode) != 0;
+    double any = minima ? DBL_MAX : -DBL_MAX;
+    std::vector<cv::Mat> pyramid(1, image);
+    std::vector<php_opencv_match> hits;
+    std::vector<php_opencv_peak> coarse, fine;
+    cv::Rect bounds(0, 0, image.cols, image.rows), search;
+    cv::Mat scaled, reduced, map;
+    php_opencv_match hit;
+    size_t i, j;
+    int level, factor, width, height, radius;
+
+    for (level = 1; level <= levels; level++) {
+        cv::Mat down;
+        cv::pyrDown(pyramid[level - 1], down);
+        pyramid.push_back(down);
+    }
+
+    for (i = 0; i < scales.size(); i++) {
+        width = cvRound(templ.cols * scales[i]);
+        height = cvRound(templ.rows * scales[i]);
+        if (width < 1 || height < 1 || width > image.cols || height > image.rows) {
+            continue;
+        }
+
+        if (width == templ.cols && height == templ.rows) {
+            scaled = templ;
+        } else {
+            cv::resize(templ, scaled, cv::Size(width, height), 0, 0, scales[i] < 1 ? cv::INTER_AREA : cv::INTER_LINEAR);
+        }
+
+        /* Go as far down the pyramid as the template stays useful */
+        reduced = scaled;
+        level = 0;
+        while (level < levels && reduced.cols / 2 >= PHP_OPENCV_MATCH_MIN_SIZE && reduced.rows / 2 >= PHP_OPENCV_MATCH_MIN_SIZE
+                && (reduced.cols + 1) / 2 <= pyramid[level + 1].cols && (reduced.rows + 1) / 2 <= pyramid[level + 1].rows) {
+            cv::Mat down;
+            cv::pyrDown(reduced, down);
+            reduced = down;
+            level++;
+        }
+
+        hit.width = width;
+        hit.height = height;
+        hit.scale = scales[i];
+        radius = std::min(reduced.cols, reduced.rows) / 2;
+
+        coarse.clear();
+        cv::matchTemplate(pyramid[level], reduced, map, mode);
+
+        if (level == 0) {
+            php_opencv_find_peaks(map, threshold, max_count, radius, minima, coarse);
+            for (j = 0; j < coarse.size(); j++) {
+                hit.x = coarse[j].x;
+                hit.y = coarse[j].y;
+                hit.score = coarse[j].score;
+                hits.push_back(hit);
+            }
+            continue;
+        }
+
+        /* Scores at a reduced level are only a guide, so take the best few
+           regardless of the threshold and let the full-size search decide */
+        php_opencv_find_peaks(map, any, max_count * PHP_OPENCV_MATCH_CANDIDATES, radius, minima, coarse);
+
+        factor = 1 << level;
+        for (j = 0; j < coarse.size(); j++) {
+            search = cv::Rect(coarse[j].x * factor - factor - margin, coarse[j].y * factor - factor - margin,
+                    width + 2 * (factor + margin), height + 2 * (factor + margin)) & bounds;
+            if (search.width < width || search.height < height) {
+                continue;
+            }
+
+            cv::matchTemplate(image(search), scaled, map, mode);
+            fine.clear();
+            php_opencv_find_peaks(map, threshold, 1, 0, minima, fine);
+            if (!fine.empty()) {
+                hit.x = search.x + fine[0].x;
+                hit.y = search.y + fine[0].y;
+                hit.score = fine[0].score;
+                hits.push_back(hit);
+            }
+        }
+    }
+
+    std::stable_sort(hits.begin(), hits.end(), minima ? php_opencv_match_lower : php_opencv_match_better);
+
+    for (i = 0; i < hits.size() && (int) matches.size() < max_count; i++) {
+        for (j = 0; j < matches.size(); j++) {
+            if (php_opencv_match_overlaps(hits[i], matches[j])) {
+                break;
+            }
+        }
+        if (j == matches.size()) {
+            matches.push_back(hits[i]);
+        }
+    }
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
@@ -0,0 +1,772 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 5                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2010 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Author: Michael Maclean <mgdm@php.net>                               |
+  +----------------------------------------------------------------------+
+*/
+
+/* $Id$ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php_opencv.h"
+
+#include <algorithm>
+#include <limits.h>
+
+zend_class_entry *opencv_ce_pipeline;
+
+enum {
+    PHP_OPENCV_OP_CONVERT_COLOR = 1,
+    PHP_OPENCV_OP_SMOOTH,
+    PHP_OPENCV_OP_CANNY,
+    PHP_OPENCV_OP_ERODE,
+    PHP_OPENCV_OP_DILATE,
+    PHP_OPENCV_OP_OPEN,
+    PHP_OPENCV_OP_CLOSE,
+    PHP_OPENCV_OP_GRADIENT,
+    PHP_OPENCV_OP_TOPHAT,
+    PHP_OPENCV_OP_BLACKHAT,
+    PHP_OPENCV_OP_LAPLACE,
+    PHP_OPENCV_OP_SOBEL,
+    PHP_OPENCV_OP_PYR_DOWN,
+    PHP_OPENCV_OP_PYR_UP,
+    PHP_OPENCV_OP_RESIZE
+};
+
+/* Returns the image in the slot if it already has the right shape, or
+   replaces it with a new one */
+static IplImage *php_opencv_pipeline_buffer(IplImage **slot, CvSize size, int depth, int channels)
+{
+    if (*slot != NULL) {
+        if ((*slot)->width == size.width && (*slot)->height == size.height
+                && (*slot)->depth == depth && (*slot)->nChannels == channels) {
+            return *slot;
+        }
+        cvReleaseImage(slot);
+    }
+    *slot = cvCreateImage(size, depth, channels);
+    return *slot;
+}
+
+static void php_opencv_pipeline_buffers_reserve(php_opencv_pipeline_buffers *buffers, int count)
+{
+    if (buffers->count >= count) {
+        return;
+    }
+
+    buffers->images = (IplImage **) realloc(buffers->images, count * sizeof(IplImage *));
+    buffers->scratch = (IplImage **) realloc(buffers->scratch, count * sizeof(IplImage *));
+    memset(buffers->images + buffers->count, 0, (count - buffers->count) * sizeof(IplImage *));
+    memset(buffers->scratch + buffers->count, 0, (count - buffers->count) * sizeof(IplImage *));
+    buffers->count = count;
+}
+
+/* Filters that give the same result when the source and destination are the
+   same image. When their input is an intermediate they write over it rather
+   than using a buffer of their own. */
+static zend_bool php_opencv_pipeline_op_in_place(const php_opencv_pipeline_op *op)
+{
+    switch (op->type) {
+        case PHP_OPENCV_OP_SMOOTH:
+            return op->params[0] == CV_GAUSSIAN || op->params[0] == CV_BLUR || op->params[0] == CV_BLUR_NO_SCALE;
+        case PHP_OPENCV_OP_ERODE:
+        case PHP_OPENCV_OP_DILATE:
+        case PHP_OPENCV_OP_OPEN:
+        case PHP_OPENCV_OP_CLOSE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* {{{ php_opencv_pipeline_exec
+   Runs each step in turn, returning the final image (still owned by the
+   buffers) or NULL with buffers->error set. This never calls into the engine,
+   so it is safe to use from worker threads with their own buffers. */
+PHP_OPENCV_API IplImage *php_opencv_pipeline_exec(const php_opencv_pipeline_op *ops, int op_count, IplImage *src, php_opencv_pipeline_buffers *buffers)
+{
+    IplImage *current = src, *dst = NULL, *input, *scratch;
+    CvSize size;
+    int i, channels, status;
+
+    php_opencv_pipeline_buffers_reserve(buffers, op_count);
+    buffers->error[0] = '\0';
+    buffers->result = NULL;
+
+    try {
+        for (i = 0; i < op_count; i++) {
+            const php_opencv_pipeline_op *op = &ops[i];
+            const double *params = op->params;
+            zend_bool in_place = current != src && php_opencv_pipeline_op_in_place(op);
+
+            size = cvGetSize(current);
+            if (in_place) {
+                dst = current;
+            }
+
+            switch (op->type) {
+                case PHP_OPENCV_OP_CONVERT_COLOR:
+                    channels = params[1] > 0 ? (int) params[1] : current->nChannels;
+                    dst = php_opencv_pipeline_buffer(&buffers->images[i], size, current->depth, channels);
+                    cvCvtColor(current, dst, (int) params[0]);
+                    break;
+
+                case PHP_OPENCV_OP_SMOOTH:
+                    if (!in_place) {
+                        dst = php_opencv_pipeline_buffer(&buffers->images[i], size, current->depth, current->nChannels);
+                    }
+                    cvSmooth(current, dst, (int) params[0], (int) params[1], (int) params[2], params[3], params[4]);
+                    break;
+
+                case PHP_OPENCV_OP_CANNY:
+                    input = current;
+                    if (current->nChannels > 1) {
+                        input = php_opencv_pipeline_buffer(&buffers->scratch[i], size, IPL_DEPTH_8U, 1);
+                        cvCvtColor(current, input, CV_BGR2GRAY);
+                    }
+                    dst = php_opencv_pipeline_buffer(&buffers->images[i], size, IPL_DEPTH_8U, 1);
+                    cvCanny(input, dst, params[0], params[1], (int) params[2]);
+                    break;
+
+                case PHP_OPENCV_OP_ERODE:
+                case PHP_OPENCV_OP_DILATE:
+                case PHP_OPENCV_OP_OPEN:
+                case PHP_OPENCV_OP_CLOSE:
+                case PHP_OPENCV_OP_TOPHAT:
+                case PHP_OPENCV_OP_BLACKHAT:
+                case PHP_OPENCV_OP_GRADIENT:
+                    if (!in_place) {
+                        dst = php_opencv_pipeline_buffer(&buffers->images[i], size, current->depth, current->nChannels);
+                    }
+                    if (op->type == PHP_OPENCV_OP_ERODE) {
+                        cvErode(current, dst, NULL, (int) params[0]);
+                    } else if (op->type == PHP_OPENCV_OP_DILATE) {
+                        cvDilate(current, dst, NULL, (int) params[0]);
+                    } else if (op->type == PHP_OPENCV_OP_OPEN) {
+                        cvMorphologyEx(current, dst, NULL, NULL, CV_MOP_OPEN, (int) params[0]);
+                    } else if (op->type == PHP_OPENCV_OP_CLOSE) {
+                        cvMorphologyEx(current, dst, NULL, NULL, CV_MOP_CLOSE, (int) params[0]);
+                    } else if (op->type == PHP_OPENCV_OP_TOPHAT) {
+                        cvMorphologyEx(current, dst, NULL, NULL, CV_MOP_TOPHAT, (int) params[0]);
+                    } else if (op->type == PHP_OPENCV_OP_BLACKHAT) {
+                        cvMorphologyEx(current, dst, NULL, NULL, CV_MOP_BLACKHAT, (int) params[0]);
+                    } else {
+                        scratch = php_opencv_pipeline_buffer(&buffers->scratch[i], size, current->depth, current->nChannels);
+                        cvMorphologyEx(current, dst, scratch, NULL, CV_MOP_GRADIENT, (int) params[0]);
+                    }
+                    break;
+
+                case PHP_OPENCV_OP_LAPLACE:
+                    dst = php_opencv_pipeline_buffer(&buffers->images[i], size, IPL_DEPTH_16S, current->nChannels);
+                    cvLaplace(current, dst, (int) params[0]);
+                    break;
+
+                case PHP_OPENCV_OP_SOBEL:
+                    dst = php_opencv_pipeline_buffer(&buffers->images[i], size, IPL_DEPTH_16S, current->nChannels);
+                    cvSobel(current, dst, (int) params[0], (int) params[1], (int) params[2]);
+                    break;
+
+                case PHP_OPENCV_OP_PYR_DOWN:
+                    dst = php_opencv_pipeline_buffer(&buffers->images[i], cvSize(size.width / 2, size.height / 2), current->depth, current->nChannels);
+                    cvPyrDown(current, dst, (int) params[0]);
+                    break;
+
+                case PHP_OPENCV_OP_PYR_UP:
+                    dst = php_opencv_pipeline_buffer(&buffers->images[i], cvSize(size.width * 2, size.height * 2), current->depth, current->nChannels);
+                    cvPyrUp(current, dst, (int) params[0]);
+                    break;
+
+                case PHP_OPENCV_OP_RESIZE:
+                    dst = php_opencv_pipeline_buffer(&buffers->images[i], cvSize((int) params[0], (int) params[1]), current->depth, current->nChannels);
+                    cvResize(current, dst, (int) params[2]);
+                    break;
+            }
+
+            status = cvGetErrStatus();
+            if (status < 0) {
+                snprintf(buffers->error, sizeof(buffers->error), "%s", cvErrorStr(status));
+                cvSetErrStatus(CV_StsOk);
+                return NULL;
+            }
+            current = dst;
+        }
+    } catch (cv::Exception &e) {
+        snprintf(buffers->error, sizeof(buffers->error), "%s", e.err.c_str());
+        return NULL;
+    }
+
+    buffers->result = current;
+    return current;
+}
+/* }}} */
+
+/* {{{ php_opencv_pipeline_take_result
+   Detaches the last result from the buffers so it can be handed to an Image.
+   Only the final buffer is reallocated on the next run. */
+PHP_OPENCV_API IplImage *php_opencv_pipeline_take_result(php_opencv_pipeline_buffers *buffers)
+{
+    IplImage *result = buffers->result;
+    int i;
+
+    for (i = 0; i < buffers->count; i++) {
+        if (buffers->images[i] == result) {
+            buffers->images[i] = NULL;
+        }
+    }
+    buffers->result = NULL;
+    return result;
+}
+/* }}} */
+
+/* {{{ php_opencv_pipeline_buffers_free */
+PHP_OPENCV_API void php_opencv_pipeline_buffers_free(php_opencv_pipeline_buffers *buffers)
+{
+    int i;
+
+    for (i = 0; i < buffers->count; i++) {
+        if (buffers->images[i] != NULL) {
+            cvReleaseImage(&buffers->images[i]);
+        }
+        if (buffers->scratch[i] != NULL) {
+            cvReleaseImage(&buffers->scratch[i]);
+        }
+    }
+    free(buffers->images);
+    free(buffers->scratch);
+    memset(buffers, 0, sizeof(php_opencv_pipeline_buffers));
+}
+/* }}} */
+
+/* How far into its input each output pixel of a step can see, or -1 for
+   steps that can't be run in tiles: those that change the image size, and
+   Canny, whose edge tracking can follow an edge across the whole image */
+static int php_opencv_pipeline_op_halo(const php_opencv_pipeline_op *op)
+{
+    const double *params = op->params;
+    int iterations = params[0] > 1 ? (int) params[0] : 1;
+    int size;
+
+    switch (op->type) {
+        case PHP_OPENCV_OP_CONVERT_COLOR:
+            /* Bayer conversions look at the neighbouring pixels */
+            return 1;
+
+        case PHP_OPENCV_OP_SMOOTH:
+            size = (int) std::max(params[1], params[2]);
+            if (size <= 0) {
+                /* The kernel is worked out from sigma; 4 sigma covers both
+                   the Gaussian and bilateral cases */
+                size = cvCeil(std::max(params[3], params[4]) * 4) * 2 + 1;
+            }
+            return size / 2;
+
+        case PHP_OPENCV_OP_ERODE:
+        case PHP_OPENCV_OP_DILATE:
+        case PHP_OPENCV_OP_GRADIENT:
+            return iterations;
+
+        case PHP_OPENCV_OP_OPEN:
+        case PHP_OPENCV_OP_CLOSE:
+        case PHP_OPENCV_OP_TOPHAT:
+        case PHP_OPENCV_OP_BLACKHAT:
+            return iterations * 2;
+
+        case PHP_OPENCV_OP_LAPLACE:
+            return std::max((int) params[0] / 2, 1);
+
+        case PHP_OPENCV_OP_SOBEL:
+            return std::max((int) params[2] / 2, 1);
+
+        default:
+            return -1;
+    }
+}
+
+/* Works out the depth and channels of the final image without running the
+   steps, so the tiles have somewhere to go */
+static void php_opencv_pipeline_output_format(const php_opencv_pipeline_op *ops, int op_count, int *depth, int *channels)
+{
+    int i;
+
+    for (i = 0; i < op_count; i++) {
+        if (ops[i].type == PHP_OPENCV_OP_CONVERT_COLOR && ops[i].params[1] > 0) {
+            *channels = (int) ops[i].params[1];
+        } else if (ops[i].type == PHP_OPENCV_OP_LAPLACE || ops[i].type == PHP_OPENCV_OP_SOBEL) {
+            *depth = IPL_DEPTH_16S;
+        }
+    }
+}
+
+typedef struct _php_opencv_pipeline_tiles {
+    const php_opencv_pipeline_op *ops;
+    int op_count;
+    cv::Mat src;
+    cv::Mat dst;
+    int tile_size;
+    int halo;
+    int columns;
+    php_opencv_pipeline_buffers *buffers;
+    char (*errors)[256];
+} php_opencv_pipeline_tiles;
+
+/* Runs the steps over one tile plus its halo and copies the middle of the
+   result into place. Tiles don't overlap in the destination, so the workers
+   never write to the same pixels. */
+static void php_opencv_pipeline_tile_task(void *ctx, int task, int worker)
+{
+    php_opencv_pipeline_tiles *tiles = (php_opencv_pipeline_tiles *) ctx;
+    php_opencv_pipeline_buffers *buffers = &tiles->buffers[worker];
+    cv::Rect inner, outer;
+    IplImage header, *result;
+
+    if (tiles->errors[worker][0] != '\0') {
+        return;
+    }
+
+    inner.x = (task % tiles->columns) * tiles->tile_size;
+    inner.y = (task / tiles->columns) * tiles->tile_size;
+    inner.width = std::min(tiles->tile_size, tiles->src.cols - inner.x);
+    inner.height = std::min(tiles->tile_size, tiles->src.rows - inner.y);
+
+    outer.x = std::max(inner.x - tiles->halo, 0);
+    outer.y = std::max(inner.y - tiles->halo, 0);
+    outer.width = std::min(inner.x + inner.width + tiles->halo, tiles->src.cols) - outer.x;
+    outer.height = std::min(inner.y + inner.height + tiles->halo, tiles->src.rows) - outer.y;
+
+    try {
+        header = tiles->src(outer);
+        result = php_opencv_pipeline_exec(tiles->ops, tiles->op_count, &header, buffers);
+        if (result == NULL) {
+            memcpy(tiles->errors[worker], buffers->error, sizeof(buffers->error));
+            return;
+        }
+
+        cv::Mat target = tiles->dst(inner);
+        cv::cvarrToMat(result)(cv::Rect(inner.x - outer.x, inner.y - outer.y, inner.width, inner.height)).copyTo(target);
+    } catch (cv::Exception &e) {
+        snprintf(tiles->errors[worker], sizeof(tiles->errors[worker]), "%s", e.err.c_str());
+    }
+}
+
+void opencv_pipeline_object_destroy(void *object TSRMLS_DC)
+{
+    opencv_pipeline_object *pipeline = (opencv_pipeline_object *)object;
+
+    zend_hash_destroy(pipeline->std.properties);
+    FREE_HASHTABLE(pipeline->std.properties);
+
+    php_opencv_pipeline_buffers_free(&pipeline->buffers);
+    if (pipeline->ops != NULL) {
+        efree(pipeline->ops);
+    }
+    efree(pipeline);
+}
+
+static zend_object_value opencv_pipeline_object_new(zend_class_entry *ce TSRMLS_DC)
+{
+    zend_object_value retval;
+    opencv_pipeline_object *pipeline;
+    zval *temp;
+
+    pipeline = (opencv_pipeline_object *) ecalloc(1, sizeof(opencv_pipeline_object));
+
+    pipeline->std.ce = ce;
+    pipeline->ops = NULL;
+    pipeline->op_count = 0;
+
+    ALLOC_HASHTABLE(pipeline->std.properties);
+    zend_hash_init(pipeline->std.properties, 0, NULL, ZVAL_PTR_DTOR, 0);
+#if PHP_VERSION_ID < 50399
+    zend_hash_copy(pipeline->std.properties, &ce->default_properties, (copy_ctor_func_t) zval_add_ref,(void *) &temp, sizeof(zval *));
+#else
+    object_properties_init(&pipeline->std, ce);
+#endif
+    retval.handle = zend_objects_store_put(pipeline, NULL, (zend_objects_free_object_storage_t)opencv_pipeline_object_destroy, NULL TSRMLS_CC);
+    retval.handlers = zend_get_std_object_handlers();
+    return retval;
+}
+
+/* Appends a step and returns the pipeline, so steps can be chained */
+static void php_opencv_pipeline_add(zval *pipeline_zval, int type, double p0, double p1, double p2, double p3, double p4, zval *return_value TSRMLS_DC)
+{
+    opencv_pipeline_object *pipeline = (opencv_pipeline_object *) zend_object_store_get_object(pipeline_zval TSRMLS_CC);
+    php_opencv_pipeline_op *op;
+
+    pipeline->ops = (php_opencv_pipeline_op *) erealloc(pipeline->ops, (pipeline->op_count + 1) * sizeof(php_opencv_pipeline_op));
+    op = &pipeline->ops[pipeline->op_count++];
+    op->type = type;
+    op->params[0] = p0;
+    op->params[1] = p1;
+    op->params[2] = p2;
+    op->params[3] = p3;
+    op->params[4] = p4;
+
+    RETVAL_ZVAL(pipeline_zval, 1, 0);
+}
+
+/* {{{ proto Pipeline convertColor(int code [, int channels]) */
+PHP_METHOD(OpenCV_Pipeline, convertColor)
+{
+    long code, channels = -1;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "l|l", &code, &channels) == FAILURE) {
+        return;
+    }
+    php_opencv_pipeline_add(getThis(), PHP_OPENCV_OP_CONVERT_COLOR, code, channels, 0, 0, 0, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto Pipeline smooth(int type [, int param1, int param2, double param3, double param4]) */
+PHP_METHOD(OpenCV_Pipeline, smooth)
+{
+    long type, param1 = 3, param2 = 0;
+    double param3 = 0, param4 = 0;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "l|lldd", &type, &param1, &param2, &param3, &param4) == FAILURE) {
+        return;
+    }
+    php_opencv_pipeline_add(getThis(), PHP_OPENCV_OP_SMOOTH, type, param1, param2, param3, param4, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto Pipeline canny(int lowThresh, int highThresh [, int apertureSize]) */
+PHP_METHOD(OpenCV_Pipeline, canny)
+{
+    long lowThresh, highThresh, apertureSize = 3;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "ll|l", &lowThresh, &highThresh, &apertureSize) == FAILURE) {
+        return;
+    }
+    php_opencv_pipeline_add(getThis(), PHP_OPENCV_OP_CANNY, lowThresh, highThresh, apertureSize, 0, 0, return_value TSRMLS_CC);
+}
+/* }}} */
+
+#define PHP_OPENCV_PIPELINE_ITERATIONS_METHOD(name, op_type) \
+PHP_METHOD(OpenCV_Pipeline, name) \
+{ \
+    long iterations = 1; \
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "|l", &iterations) == FAILURE) { \
+        return; \
+    } \
+    php_opencv_pipeline_add(getThis(), op_type, iterations, 0, 0, 0, 0, return_value TSRMLS_CC); \
+}
+
+/* {{{ proto Pipeline erode([int iterations]) etc. */
+PHP_OPENCV_PIPELINE_ITERATIONS_METHOD(erode, PHP_OPENCV_OP_ERODE)
+PHP_OPENCV_PIPELINE_ITERATIONS_METHOD(dilate, PHP_OPENCV_OP_DILATE)
+PHP_OPENCV_PIPELINE_ITERATIONS_METHOD(open, PHP_OPENCV_OP_OPEN)
+PHP_OPENCV_PIPELINE_ITERATIONS_METHOD(close, PHP_OPENCV_OP_CLOSE)
+PHP_OPENCV_PIPELINE_ITERATIONS_METHOD(gradient, PHP_OPENCV_OP_GRADIENT)
+PHP_OPENCV_PIPELINE_ITERATIONS_METHOD(topHat, PHP_OPENCV_OP_TOPHAT)
+PHP_OPENCV_PIPELINE_ITERATIONS_METHOD(blackHat, PHP_OPENCV_OP_BLACKHAT)
+/* }}} */
+
+/* {{{ proto Pipeline laplace([int apertureSize]) */
+PHP_METHOD(OpenCV_Pipeline, laplace)
+{
+    long apertureSize = 3;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "|l", &apertureSize) == FAILURE) {
+        return;
+    }
+    php_opencv_pipeline_add(getThis(), PHP_OPENCV_OP_LAPLACE, apertureSize, 0, 0, 0, 0, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto Pipeline sobel(int xorder, int yorder [, int apertureSize]) */
+PHP_METHOD(OpenCV_Pipeline, sobel)
+{
+    long xorder, yorder, apertureSize = 3;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "ll|l", &xorder, &yorder, &apertureSize) == FAILURE) {
+        return;
+    }
+    php_opencv_pipeline_add(getThis(), PHP_OPENCV_OP_SOBEL, xorder, yorder, apertureSize, 0, 0, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto Pipeline pyrDown([int filter]) */
+PHP_METHOD(OpenCV_Pipeline, pyrDown)
+{
+    long filter = CV_GAUSSIAN_5x5;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "|l", &filter) == FAILURE) {
+        return;
+    }
+    php_opencv_pipeline_add(getThis(), PHP_OPENCV_OP_PYR_DOWN, filter, 0, 0, 0, 0, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto Pipeline pyrUp([int filter]) */
+PHP_METHOD(OpenCV_Pipeline, pyrUp)
+{
+    long filter = CV_GAUSSIAN_5x5;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "|l", &filter) == FAILURE) {
+        return;
+    }
+    php_opencv_pipeline_add(getThis(), PHP_OPENCV_OP_PYR_UP, filter, 0, 0, 0, 0, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto Pipeline resize(int width, int height [, int interpolation]) */
+PHP_METHOD(OpenCV_Pipeline, resize)
+{
+    long width, height, interpolation = CV_INTER_LINEAR;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "ll|l", &width, &height, &interpolation) == FAILURE) {
+        return;
+    }
+    if (width <= 0 || height <= 0) {
+        zend_throw_exception(opencv_ce_cvexception, "The width and height must be greater than zero", 0 TSRMLS_CC);
+        return;
+    }
+    php_opencv_pipeline_add(getThis(), PHP_OPENCV_OP_RESIZE, width, height, interpolation, 0, 0, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto int count()
+       Returns the number of steps in the pipeline */
+PHP_METHOD(OpenCV_Pipeline, count)
+{
+    opencv_pipeline_object *pipeline;
+
+    if (zend_parse_parameters_none() == FAILURE) {
+        return;
+    }
+
+    pipeline = (opencv_pipeline_object *) zend_object_store_get_object(getThis() TSRMLS_CC);
+    RETURN_LONG(pipeline->op_count);
+}
+/* }}} */
+
+/* {{{ proto Image run(Image image [, Image dst])
+       Runs every step natively and returns only the final image. If dst is
+       given the result is copied into it instead of allocating a new image. */
+PHP_METHOD(OpenCV_Pipeline, run)
+{
+    opencv_pipeline_object *pipeline;
+    opencv_image_object *image_object, *dst_object;
+    zval *pipeline_zval, *image_zval, *dst_zval = NULL;
+    IplImage *result;
+    CvSize dst_size;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "OO|O!", &pipeline_zval, opencv_ce_pipeline, &image_zval, opencv_ce_image, &dst_zval, opencv_ce_image) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    pipeline = (opencv_pipeline_object *) zend_object_store_get_object(pipeline_zval TSRMLS_CC);
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+
+    if (pipeline->op_count == 0) {
+        zend_throw_exception(opencv_ce_cvexception, "The pipeline has no steps", 0 TSRMLS_CC);
+        return;
+    }
+
+    result = php_opencv_pipeline_exec(pipeline->ops, pipeline->op_count, image_object->cvptr, &pipeline->buffers);
+    if (result == NULL) {
+        zend_throw_exception(opencv_ce_cvexception, pipeline->buffers.error, 0 TSRMLS_CC);
+        return;
+    }
+
+    if (dst_zval != NULL) {
+        dst_object = opencv_image_object_get(dst_zval TSRMLS_CC);
+        dst_size = cvGetSize(dst_object->cvptr);
+        if (dst_size.width != result->width || dst_size.height != result->height
+                || dst_object->cvptr->depth != result->depth || dst_object->cvptr->nChannels != result->nChannels) {
+            zend_throw_exception(opencv_ce_cvexception, "The destination image must have the same size, depth and channels as the result", 0 TSRMLS_CC);
+            return;
+        }
+        cvCopy(result, dst_object->cvptr);
+        RETVAL_ZVAL(dst_zval, 1, 0);
+    } else {
+        php_opencv_make_image_zval(php_opencv_pipeline_take_result(&pipeline->buffers), return_value TSRMLS_CC);
+    }
+
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* Whether two images' pixel buffers overlap, such as an image and a view of
+   it. Tiles read a halo around themselves, so a destination sharing any
+   memory with the source could be written while another tile reads it. */
+static int php_opencv_pipeline_overlaps(const IplImage *a, const IplImage *b)
+{
+    const char *a_end = a->imageData + (size_t) a->widthStep * a->height;
+    const char *b_end = b->imageData + (size_t) b->widthStep * b->height;
+
+    return a->imageData < b_end && b->imageData < a_end;
+}
+
+/* {{{ proto Image runTiled(Image image [, int tileSize [, int threads [, Image dst]]])
+       Runs the steps over tileSize x tileSize tiles of the image in parallel
+       and stitches the results together. Each tile is read with enough of a
+       border that the result matches run(), while each thread only needs
+       buffers the size of a tile. Steps that resize the image and canny()
+       cannot be tiled. */
+PHP_METHOD(OpenCV_Pipeline, runTiled)
+{
+    opencv_pipeline_object *pipeline;
+    opencv_image_object *image_object, *dst_object;
+    zval *pipeline_zval, *image_zval, *dst_zval = NULL;
+    php_opencv_pipeline_tiles tiles;
+    IplImage *src, *dst;
+    CvSize size;
+    long tile_size = 1024, threads = 0;
+    int depth, channels, halo, rows, thread_count, i;
+    const char *error = NULL;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "OO|llO!", &pipeline_zval, opencv_ce_pipeline, &image_zval, opencv_ce_image, &tile_size, &threads, &dst_zval, opencv_ce_image) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    pipeline = (opencv_pipeline_object *) zend_object_store_get_object(pipeline_zval TSRMLS_CC);
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    src = image_object->cvptr;
+
+    if (pipeline->op_count == 0) {
+        zend_throw_exception(opencv_ce_cvexception, "The pipeline has no steps", 0 TSRMLS_CC);
+        return;
+    }
+    if (tile_size <= 0) {
+        zend_throw_exception(opencv_ce_cvexception, "The tile size must be greater than zero", 0 TSRMLS_CC);
+        return;
+    }
+
+    halo = 0;
+    for (i = 0; i < pipeline->op_count; i++) {
+        int op_halo = php_opencv_pipeline_op_halo(&pipeline->ops[i]);
+        if (op_halo < 0) {
+            zend_throw_exception(opencv_ce_cvexception, "Pipelines with canny, pyrDown, pyrUp or resize steps cannot be run in tiles", 0 TSRMLS_CC);
+            return;
+        }
+        halo += op_halo;
+    }
+
+    size = cvGetSize(src);
+    depth = src->depth;
+    channels = src->nChannels;
+    php_opencv_pipeline_output_format(pipeline->ops, pipeline->op_count, &depth, &channels);
+
+    if (dst_zval != NULL) {
+        dst_object = opencv_image_object_get(dst_zval TSRMLS_CC);
+        dst = dst_object->cvptr;
+        if (php_opencv_pipeline_overlaps(src, dst)) {
+            zend_throw_exception(opencv_ce_cvexception, "The destination image must not share pixels with the source image", 0 TSRMLS_CC);
+            return;
+        }
+        if (cvGetSize(dst).width != size.width || cvGetSize(dst).height != size.height
+                || dst->depth != depth || dst->nChannels != channels) {
+            zend_throw_exception(opencv_ce_cvexception, "The destination image must have the same size, depth and channels as the result", 0 TSRMLS_CC);
+            return;
+        }
+    } else {
+        dst = cvCreateImage(size, depth, channels);
+        dst->origin = src->origin;
+    }
+
+    tiles.ops = pipeline->ops;
+    tiles.op_count = pipeline->op_count;
+    tiles.src = cv::cvarrToMat(src);
+    tiles.dst = cv::cvarrToMat(dst);
+    tiles.tile_size = (int) std::min(tile_size, (long) INT_MAX);
+    tiles.halo = halo;
+    tiles.columns = (size.width + tiles.tile_size - 1) / tiles.tile_size;
+    rows = (size.height + tiles.tile_size - 1) / tiles.tile_size;
+
+    thread_count = php_opencv_thread_count(threads TSRMLS_CC);
+    tiles.buffers = (php_opencv_pipeline_buffers *) ecalloc(thread_count, sizeof(php_opencv_pipeline_buffers));
+    tiles.errors = (char (*)[256]) ecalloc(thread_count, sizeof(*tiles.errors));
+
+    php_opencv_parallel_run(tiles.columns * rows, thread_count, php_opencv_pipeline_tile_task, &tiles);
+
+    for (i = 0; i < thread_count; i++) {
+        if (error == NULL && tiles.errors[i][0] != '\0') {
+            error = tiles.errors[i];
+        }
+    }
+
+    if (error != NULL) {
+        zend_throw_exception(opencv_ce_cvexception, (char *) error, 0 TSRMLS_CC);
+        if (dst_zval == NULL) {
+            cvReleaseImage(&dst);
+        }
+    } else if (dst_zval != NULL) {
+        RETVAL_ZVAL(dst_zval, 1, 0);
+    } else {
+        php_opencv_make_image_zval(dst, return_value TSRMLS_CC);
+    }
+
+    for (i = 0; i < thread_count; i++) {
+        php_opencv_pipeline_buffers_free(&tiles.buffers[i]);
+    }
+    efree(tiles.buffers);
+    efree(tiles.errors);
+}
+/* }}} */
+
+/* {{{ opencv_pipeline_methods[] */
+const zend_function_entry opencv_pipeline_methods[] = {
+    PHP_ME(OpenCV_Pipeline, convertColor, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, smooth, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, canny, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, erode, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, dilate, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, open, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, close, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, gradient, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, topHat, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, blackHat, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, laplace, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, sobel, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, pyrDown, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, pyrUp, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, resize, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, count, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, run, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(OpenCV_Pipeline, runTiled, NULL, ZEND_ACC_PUBLIC)
+    {NULL, NULL, NULL}
+};
+/* }}} */
+
+/* {{{ PHP_MINIT_FUNCTION */
+PHP_MINIT_FUNCTION(opencv_pipeline)
+{
+    zend_class_entry ce;
+
+    INIT_NS_CLASS_ENTRY(ce, "OpenCV", "Pipeline", opencv_pipeline_methods);
+    opencv_ce_pipeline = zend_register_internal_class(&ce TSRMLS_CC);
+    opencv_ce_pipeline->create_object = opencv_pipeline_object_new;
+
+    return SUCCESS;
+}
+/* }}} */
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
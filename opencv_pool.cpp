@@ -0,0 +1,174 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 5                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2010 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Author: Michael Maclean <mgdm@php.net>                               |
+  +----------------------------------------------------------------------+
+*/
+
+/* $Id$ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php_opencv.h"
+
+/* Released images are kept per thread in the module globals and handed back
+   out for the next image of the same shape, so frame loops stop paying for a
+   large aligned malloc and the page faults on it every frame. The most
+   recently released image is reused first, and the oldest is freed once
+   opencv.image_pool_size images or opencv.image_pool_memory megabytes are
+   held. Only the engine thread uses the pool; worker threads allocate
+   directly, but their results are recycled here once PHP frees them. */
+
+/* The row size cvCreateImage() would give an image of this shape */
+static int php_opencv_image_pool_step(CvSize size, int depth, int channels)
+{
+    return (((size.width * channels * (depth & ~IPL_DEPTH_SIGN) + 7) / 8) + 3) & -4;
+}
+
+static void php_opencv_image_pool_evict(int index TSRMLS_DC)
+{
+    IplImage *image = OPENCV_G(image_pool)[index];
+
+    OPENCV_G(image_pool_bytes) -= image->imageSize;
+    memmove(&OPENCV_G(image_pool)[index], &OPENCV_G(image_pool)[index + 1], (OPENCV_G(image_pool_count) - index - 1) * sizeof(IplImage *));
+    OPENCV_G(image_pool_count)--;
+    cvReleaseImage(&image);
+}
+
+/* {{{ php_opencv_image_create
+   Returns an image of the given shape, reusing a released one if the pool
+   has it. Like cvCreateImage(), the pixels are not cleared. */
+PHP_OPENCV_API IplImage *php_opencv_image_create(CvSize size, int depth, int channels TSRMLS_DC)
+{
+    IplImage *image;
+    int step = php_opencv_image_pool_step(size, depth, channels), i;
+
+    for (i = OPENCV_G(image_pool_count) - 1; i >= 0; i--) {
+        image = OPENCV_G(image_pool)[i];
+        if (image->width == size.width && image->height == size.height && image->depth == depth
+                && image->nChannels == channels && image->widthStep == step) {
+            OPENCV_G(image_pool_bytes) -= image->imageSize;
+            memmove(&OPENCV_G(image_pool)[i], &OPENCV_G(image_pool)[i + 1], (OPENCV_G(image_pool_count) - i - 1) * sizeof(IplImage *));
+            OPENCV_G(image_pool_count)--;
+            OPENCV_G(image_pool_hits)++;
+            return image;
+        }
+    }
+
+    OPENCV_G(image_pool_misses)++;
+    return cvCreateImage(size, depth, channels);
+}
+/* }}} */
+
+/* {{{ php_opencv_image_clone
+   A pooled cvCloneImage(), copying the ROI and origin along with the pixels */
+PHP_OPENCV_API IplImage *php_opencv_image_clone(const IplImage *src TSRMLS_DC)
+{
+    IplImage *dst;
+    int y, row_size;
+
+    if (src->dataOrder != IPL_DATA_ORDER_PIXEL) {
+        return cvCloneImage(src);
+    }
+
+    dst = php_opencv_image_create(cvSize(src->width, src->height), src->depth, src->nChannels TSRMLS_CC);
+    if (dst->widthStep == src->widthStep) {
+        memcpy(dst->imageData, src->imageData, src->imageSize);
+    } else {
+        row_size = MIN(dst->widthStep, src->widthStep);
+        for (y = 0; y < src->height; y++) {
+            memcpy(dst->imageData + y * dst->widthStep, src->imageData + y * src->widthStep, row_size);
+        }
+    }
+
+    dst->origin = src->origin;
+    dst->alphaChannel = src->alphaChannel;
+    if (src->roi != NULL) {
+        cvSetImageROI(dst, cvRect(src->roi->xOffset, src->roi->yOffset, src->roi->width, src->roi->height));
+        cvSetImageCOI(dst, src->roi->coi);
+    }
+    return dst;
+}
+/* }}} */
+
+/* {{{ php_opencv_image_release
+   Gives an image back to the pool, or frees it if the pool is full or the
+   image is larger than the pool may hold */
+PHP_OPENCV_API void php_opencv_image_release(IplImage **image TSRMLS_DC)
+{
+    IplImage *released = *image;
+    size_t max_bytes = (size_t) MAX(OPENCV_G(image_pool_memory), 0) * 1024 * 1024;
+
+    *image = NULL;
+    if (released == NULL) {
+        return;
+    }
+
+    if (OPENCV_G(image_pool_size) <= 0 || (size_t) released->imageSize > max_bytes
+            || released->dataOrder != IPL_DATA_ORDER_PIXEL || released->imageDataOrigin == NULL
+            || released->widthStep != php_opencv_image_pool_step(cvSize(released->width, released->height), released->depth, released->nChannels)) {
+        OPENCV_G(image_pool_discards)++;
+        cvReleaseImage(&released);
+        return;
+    }
+
+    while (OPENCV_G(image_pool_count) > 0 && (OPENCV_G(image_pool_count) >= OPENCV_G(image_pool_size)
+            || OPENCV_G(image_pool_bytes) + released->imageSize > max_bytes)) {
+        php_opencv_image_pool_evict(0 TSRMLS_CC);
+        OPENCV_G(image_pool_discards)++;
+    }
+
+    if (OPENCV_G(image_pool_count) >= OPENCV_G(image_pool_capacity)) {
+        OPENCV_G(image_pool_capacity) = MAX(8, OPENCV_G(image_pool_capacity) * 2);
+        OPENCV_G(image_pool) = (IplImage **) realloc(OPENCV_G(image_pool), OPENCV_G(image_pool_capacity) * sizeof(IplImage *));
+    }
+
+    /* Reset everything a caller could have changed so it comes back out the
+       same as a new image */
+    cvResetImageROI(released);
+    released->origin = IPL_ORIGIN_TL;
+    released->alphaChannel = 0;
+
+    OPENCV_G(image_pool)[OPENCV_G(image_pool_count)++] = released;
+    OPENCV_G(image_pool_bytes) += released->imageSize;
+}
+/* }}} */
+
+/* {{{ php_opencv_image_pool_clear
+   Frees every pooled image, when the globals are torn down */
+PHP_OPENCV_API void php_opencv_image_pool_clear(zend_opencv_globals *opencv_globals)
+{
+    int i;
+
+    for (i = 0; i < opencv_globals->image_pool_count; i++) {
+        cvReleaseImage(&opencv_globals->image_pool[i]);
+    }
+    free(opencv_globals->image_pool);
+    opencv_globals->image_pool = NULL;
+    opencv_globals->image_pool_count = 0;
+    opencv_globals->image_pool_capacity = 0;
+    opencv_globals->image_pool_bytes = 0;
+}
+/* }}} */
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
@@ -0,0 +1,232 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 5                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2010 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Author: Michael Maclean <mgdm@php.net>                               |
+  +----------------------------------------------------------------------+
+*/
+
+/* $Id$ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php_opencv.h"
+
+#include <stdio.h>
+#include <setjmp.h>
+
+#ifdef HAVE_OPENCV_JPEG
+extern "C" {
+#include <jpeglib.h>
+}
+#endif
+
+/* Works out the largest size that fits inside max_width x max_height with
+   the same aspect ratio, only growing the image if enlarge is set */
+static CvSize php_opencv_scaled_size(int width, int height, int max_width, int max_height, zend_bool enlarge)
+{
+    double scale = MIN((double) max_width / width, (double) max_height / height);
+
+    if (scale > 1 && !enlarge) {
+        scale = 1;
+    }
+    return cvSize(MAX(1, cvRound(width * scale)), MAX(1, cvRound(height * scale)));
+}
+
+/* Resizes the image to size, releasing the original if a copy was needed */
+static IplImage *php_opencv_scaled_finish(IplImage *image, CvSize size, int interpolation)
+{
+    IplImage *dst;
+
+    if (image->width == size.width && image->height == size.height) {
+        return image;
+    }
+
+    try {
+        dst = cvCreateImage(size, image->depth, image->nChannels);
+        cvResize(image, dst, interpolation);
+    } catch (cv::Exception &e) {
+        cvReleaseImage(&image);
+        throw;
+    }
+    cvReleaseImage(&image);
+    return dst;
+}
+
+#ifdef HAVE_OPENCV_JPEG
+typedef struct _php_opencv_jpeg_error {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+} php_opencv_jpeg_error;
+
+static void php_opencv_jpeg_error_exit(j_common_ptr cinfo)
+{
+    longjmp(((php_opencv_jpeg_error *) cinfo->err)->jump, 1);
+}
+
+static void php_opencv_jpeg_output_message(j_common_ptr cinfo)
+{
+    /* Warnings about damaged files would otherwise go to stderr */
+}
+
+/* {{{ php_opencv_load_jpeg_scaled
+   Decodes a JPEG at the smallest DCT scale (1/8, 1/4, 1/2) that is still at
+   least the target size, then box filters the scanlines by the remaining
+   whole factor as they are read. Only one scanline of the decoded image is
+   held at a time (progressive files still need libjpeg's coefficient
+   buffer), so memory stays close to the size of the result. Returns
+   NULL for anything libjpeg can't produce as 8-bit grey or RGB, such as
+   CMYK files, so the caller can fall back to a full decode. */
+static IplImage *php_opencv_load_jpeg_scaled(FILE *file, int max_width, int max_height, int mode, zend_bool enlarge, int interpolation)
+{
+    struct jpeg_decompress_struct cinfo;
+    php_opencv_jpeg_error jerr;
+    IplImage * volatile reduced = NULL;
+    JSAMPARRAY scanline;
+    unsigned int *sums;
+    unsigned char *row;
+    CvSize size;
+    int channels, denom, factor, width, height, x, y, c, block_rows, block_cols, count;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = php_opencv_jpeg_error_exit;
+    jerr.pub.output_message = php_opencv_jpeg_output_message;
+
+    if (setjmp(jerr.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        if (reduced != NULL) {
+            IplImage *image = reduced;
+            cvReleaseImage(&image);
+        }
+        return NULL;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, file);
+    jpeg_read_header(&cinfo, TRUE);
+
+    if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK) {
+        jpeg_destroy_decompress(&cinfo);
+        return NULL;
+    }
+
+    /* The same channels cvLoadImage() would give for this mode */
+    if (mode == CV_LOAD_IMAGE_GRAYSCALE || (mode < 0 && cinfo.num_components == 1)) {
+        cinfo.out_color_space = JCS_GRAYSCALE;
+        channels = 1;
+    } else {
+        cinfo.out_color_space = JCS_RGB;
+        channels = 3;
+    }
+
+    size = php_opencv_scaled_size(cinfo.image_width, cinfo.image_height, max_width, max_height, enlarge);
+    for (denom = 8; denom > 1; denom /= 2) {
+        if ((int) (cinfo.image_width + denom - 1) / denom >= size.width
+                && (int) (cinfo.image_height + denom - 1) / denom >= size.height) {
+            break;
+        }
+    }
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = denom;
+    jpeg_start_decompress(&cinfo);
+
+    width = cinfo.output_width;
+    height = cinfo.output_height;
+    factor = MAX(1, MIN(width / size.width, height / size.height));
+
+    try {
+        reduced = cvCreateImage(cvSize((width + factor - 1) / factor, (height + factor - 1) / factor), IPL_DEPTH_8U, channels);
+    } catch (cv::Exception &e) {
+        jpeg_destroy_decompress(&cinfo);
+        throw;
+    }
+    scanline = (*cinfo.mem->alloc_sarray)((j_common_ptr) &cinfo, JPOOL_IMAGE, width * channels, 1);
+    sums = (unsigned int *) (*cinfo.mem->alloc_large)((j_common_ptr) &cinfo, JPOOL_IMAGE, reduced->width * channels * sizeof(unsigned int));
+
+    for (y = 0; y < reduced->height; y++) {
+        block_rows = MIN(factor, height - y * factor);
+        memset(sums, 0, reduced->width * channels * sizeof(unsigned int));
+
+        for (count = 0; count < block_rows; count++) {
+            while (jpeg_read_scanlines(&cinfo, scanline, 1) != 1);
+            for (x = 0; x < width; x++) {
+                for (c = 0; c < channels; c++) {
+                    sums[(x / factor) * channels + c] += scanline[0][x * channels + c];
+                }
+            }
+        }
+
+        /* libjpeg gives RGB, images are BGR */
+        row = (unsigned char *) reduced->imageData + y * reduced->widthStep;
+        for (x = 0; x < reduced->width; x++) {
+            block_cols = MIN(factor, width - x * factor);
+            count = block_rows * block_cols;
+            for (c = 0; c < channels; c++) {
+                row[x * channels + c] = (unsigned char) ((sums[x * channels + channels - 1 - c] + count / 2) / count);
+            }
+        }
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    return php_opencv_scaled_finish(reduced, size, interpolation);
+}
+/* }}} */
+#endif
+
+/* {{{ php_opencv_load_scaled
+   Loads an image to fit within max_width x max_height. JPEGs are decoded at
+   a reduced scale where possible; other formats are decoded in full and then
+   resized. Returns NULL if the file can't be loaded. This doesn't touch the
+   engine, so it can be used from worker threads. */
+PHP_OPENCV_API IplImage *php_opencv_load_scaled(const char *filename, int max_width, int max_height, int mode, zend_bool enlarge, int interpolation)
+{
+    IplImage *image;
+
+#ifdef HAVE_OPENCV_JPEG
+    FILE *file = fopen(filename, "rb");
+    unsigned char magic[3];
+
+    if (file != NULL) {
+        image = NULL;
+        if (fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+                && magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF) {
+            rewind(file);
+            image = php_opencv_load_jpeg_scaled(file, max_width, max_height, mode, enlarge, interpolation);
+        }
+        fclose(file);
+        if (image != NULL) {
+            return image;
+        }
+    }
+#endif
+
+    image = cvLoadImage(filename, mode);
+    if (image == NULL) {
+        return NULL;
+    }
+    return php_opencv_scaled_finish(image, php_opencv_scaled_size(image->width, image->height, max_width, max_height, enlarge), interpolation);
+}
+/* }}} */
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
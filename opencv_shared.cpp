@@ -0,0 +1,490 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 5                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2010 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Author: Michael Maclean <mgdm@php.net>                               |
+  +----------------------------------------------------------------------+
+*/
+
+/* $Id$ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+#include "php_opencv.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+
+zend_class_entry *opencv_ce_sharedimage;
+
+/* Pixel data starts on a cache line boundary */
+#define PHP_OPENCV_RAW_ALIGN 64
+
+/* {{{ php_opencv_raw_init
+   Fills in a raw header for the given shape and returns the total size of
+   the header and data. Images keep IplImage's 4 byte row alignment; Mats
+   are packed. */
+PHP_OPENCV_API size_t php_opencv_raw_init(php_opencv_raw_header *header, int kind, int width, int height, int depth, int channels, size_t elem_size)
+{
+    memset(header, 0, sizeof(php_opencv_raw_header));
+    memcpy(header->magic, PHP_OPENCV_RAW_MAGIC, sizeof(header->magic));
+    header->version = PHP_OPENCV_RAW_VERSION;
+    header->kind = kind;
+    header->width = width;
+    header->height = height;
+    header->depth = depth;
+    header->channels = channels;
+    header->row_size = width * elem_size;
+    if (kind == PHP_OPENCV_RAW_IMAGE) {
+        header->row_size = (header->row_size + 3) & ~((uint64_t) 3);
+    }
+    header->data_offset = (sizeof(php_opencv_raw_header) + PHP_OPENCV_RAW_ALIGN - 1) & ~((uint64_t) PHP_OPENCV_RAW_ALIGN - 1);
+
+    return header->data_offset + header->row_size * height;
+}
+/* }}} */
+
+/* {{{ php_opencv_raw_check
+   Makes sure a mapped header is one of ours, that it describes a shape
+   OpenCV can take, and that the data fits in the mapping. The header may
+   come from a file or a segment written by anyone, so nothing in it is
+   trusted. */
+PHP_OPENCV_API int php_opencv_raw_check(const php_opencv_raw_header *header, size_t length, int kind TSRMLS_DC)
+{
+    uint64_t elem_size, elem_size1;
+    int valid;
+
+    if (length < sizeof(php_opencv_raw_header) || memcmp(header->magic, PHP_OPENCV_RAW_MAGIC, sizeof(header->magic)) != 0) {
+        zend_throw_exception(opencv_ce_cvexception, "The data is not a raw OpenCV image", 0 TSRMLS_CC);
+        return FAILURE;
+    }
+    if (header->version != PHP_OPENCV_RAW_VERSION) {
+        zend_throw_exception(opencv_ce_cvexception, "The raw image was written by an unsupported version", 0 TSRMLS_CC);
+        return FAILURE;
+    }
+    if (header->kind != (uint32_t) kind) {
+        zend_throw_exception(opencv_ce_cvexception, kind == PHP_OPENCV_RAW_IMAGE ? "The raw data holds a Mat, not an Image" : "The raw data holds an Image, not a Mat", 0 TSRMLS_CC);
+        return FAILURE;
+    }
+    if (kind == PHP_OPENCV_RAW_IMAGE) {
+        valid = php_opencv_image_format_valid(header->depth, header->channels);
+        elem_size = header->channels * ((header->depth & 255) >> 3);
+        elem_size1 = 1;
+    } else {
+        valid = CV_MAT_DEPTH(header->depth) != CV_USRTYPE1 && header->depth == CV_MAKETYPE(CV_MAT_DEPTH(header->depth), header->channels)
+            && header->channels >= 1 && header->channels <= CV_CN_MAX;
+        elem_size = CV_ELEM_SIZE(header->depth);
+        elem_size1 = CV_ELEM_SIZE1(header->depth);
+    }
+    if (!valid || header->width <= 0 || header->height <= 0) {
+        zend_throw_exception(opencv_ce_cvexception, "The raw image header has an invalid size, depth or channels", 0 TSRMLS_CC);
+        return FAILURE;
+    }
+
+    /* Rows may be padded but never shorter than the pixels they hold, and
+       each dimension is at most 2^31, so the packed row size can't overflow */
+    if (header->row_size < (uint64_t) header->width * elem_size || header->row_size % elem_size1 != 0
+            || header->row_size > INT_MAX
+            || header->data_offset < sizeof(php_opencv_raw_header) || header->data_offset > length
+            || header->row_size > (length - header->data_offset) / (uint64_t) header->height) {
+        zend_throw_exception(opencv_ce_cvexception, "The raw image header is corrupt or the data is truncated", 0 TSRMLS_CC);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+/* }}} */
+
+/* {{{ php_opencv_raw_image
+   Creates an image header over a mapped raw image, without copying. The
+   header must have passed php_opencv_raw_check(). Throws and returns NULL
+   if OpenCV still refuses it. */
+PHP_OPENCV_API IplImage *php_opencv_raw_image(php_opencv_mapping *mapping TSRMLS_DC)
+{
+    php_opencv_raw_header *header = (php_opencv_raw_header *) mapping->addr;
+    IplImage *image = NULL;
+
+    try {
+        image = cvCreateImageHeader(cvSize(header->width, header->height), header->depth, header->channels);
+        image->origin = header->origin ? IPL_ORIGIN_BL : IPL_ORIGIN_TL;
+        cvSetData(image, (char *) mapping->addr + header->data_offset, (int) header->row_size);
+    } catch (cv::Exception &e) {
+        if (image != NULL) {
+            cvReleaseImageHeader(&image);
+        }
+        php_opencv_throw_cv_exception(e TSRMLS_CC);
+        return NULL;
+    }
+    return image;
+}
+/* }}} */
+
+/* {{{ php_opencv_mapping_release
+   Unmaps a mapping used as the backing of an image or Mat */
+PHP_OPENCV_API void php_opencv_mapping_release(void *backing TSRMLS_DC)
+{
+    php_opencv_mapping *mapping = (php_opencv_mapping *) backing;
+
+    munmap(mapping->addr, mapping->length);
+    if (mapping->name != NULL) {
+        efree(mapping->name);
+    }
+    efree(mapping);
+}
+/* }}} */
+
+/* {{{ php_opencv_raw_map_file
+   Maps a raw image file copy-on-write, so the result can be modified
+   without changing the file */
+PHP_OPENCV_API php_opencv_mapping *php_opencv_raw_map_file(const char *filename, int kind TSRMLS_DC)
+{
+    php_opencv_mapping *mapping;
+    struct stat st;
+    void *addr;
+    int fd;
+
+    php_opencv_basedir_check(filename TSRMLS_CC);
+    if (EG(exception)) {
+        return NULL;
+    }
+
+    fd = VCWD_OPEN(filename, O_RDONLY);
+    if (fd < 0) {
+        zend_throw_exception_ex(opencv_ce_cvexception, errno TSRMLS_CC, "Could not open %s: %s", filename, strerror(errno));
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        zend_throw_exception_ex(opencv_ce_cvexception, 0 TSRMLS_CC, "Could not read %s", filename);
+        close(fd);
+        return NULL;
+    }
+
+    addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        zend_throw_exception_ex(opencv_ce_cvexception, errno TSRMLS_CC, "Could not map %s: %s", filename, strerror(errno));
+        return NULL;
+    }
+
+    mapping = (php_opencv_mapping *) emalloc(sizeof(php_opencv_mapping));
+    mapping->addr = addr;
+    mapping->length = st.st_size;
+    mapping->name = NULL;
+
+    if (php_opencv_raw_check((php_opencv_raw_header *) addr, mapping->length, kind TSRMLS_CC) == FAILURE) {
+        php_opencv_mapping_release(mapping TSRMLS_CC);
+        return NULL;
+    }
+    return mapping;
+}
+/* }}} */
+
+/* {{{ php_opencv_raw_write_file
+   Writes a header and the rows of data in the layout the header describes.
+   The file is written under a temporary name and renamed into place, so a
+   reader never maps a half-written file. */
+PHP_OPENCV_API int php_opencv_raw_write_file(const char *filename, php_opencv_raw_header *header, const cv::Mat &data TSRMLS_DC)
+{
+    char *temp_name;
+    char padding[PHP_OPENCV_RAW_ALIGN] = {0};
+    size_t packed_size = data.cols * data.elemSize();
+    FILE *fp;
+    int i, ok;
+
+    php_opencv_basedir_check(filename TSRMLS_CC);
+    if (EG(exception)) {
+        return FAILURE;
+    }
+
+    spprintf(&temp_name, 0, "%s.%ld.tmp", filename, (long) getpid());
+    fp = VCWD_FOPEN(temp_name, "wb");
+    if (fp == NULL) {
+        zend_throw_exception_ex(opencv_ce_cvexception, errno TSRMLS_CC, "Could not open %s for writing: %s", temp_name, strerror(errno));
+        efree(temp_name);
+        return FAILURE;
+    }
+
+    ok = fwrite(header, sizeof(php_opencv_raw_header), 1, fp) == 1
+        && fwrite(padding, header->data_offset - sizeof(php_opencv_raw_header), 1, fp) == 1;
+    for (i = 0; ok && i < data.rows; i++) {
+        ok = fwrite(data.ptr(i), packed_size, 1, fp) == 1
+            && (header->row_size == packed_size || fwrite(padding, header->row_size - packed_size, 1, fp) == 1);
+    }
+    ok = (fclose(fp) == 0) && ok;
+
+    if (!ok || VCWD_RENAME(temp_name, filename) != 0) {
+        zend_throw_exception_ex(opencv_ce_cvexception, errno TSRMLS_CC, "Could not write %s: %s", filename, strerror(errno));
+        VCWD_UNLINK(temp_name);
+        efree(temp_name);
+        return FAILURE;
+    }
+
+    efree(temp_name);
+    return SUCCESS;
+}
+/* }}} */
+
+/* Maps a shared memory segment, creating and sizing it if length is given */
+static php_opencv_mapping *php_opencv_shm_map(const char *name, size_t length TSRMLS_DC)
+{
+    php_opencv_mapping *mapping;
+    struct stat st;
+    void *addr;
+    int fd;
+
+    if (name[0] != '/' || strchr(name + 1, '/') != NULL) {
+        zend_throw_exception(opencv_ce_cvexception, "Shared image names must start with a / and contain no other slashes", 0 TSRMLS_CC);
+        return NULL;
+    }
+
+    fd = shm_open(name, length > 0 ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600);
+    if (fd < 0) {
+        zend_throw_exception_ex(opencv_ce_cvexception, errno TSRMLS_CC, "Could not open shared memory %s: %s", name, strerror(errno));
+        return NULL;
+    }
+
+    if (length > 0) {
+        if (ftruncate(fd, length) != 0) {
+            zend_throw_exception_ex(opencv_ce_cvexception, errno TSRMLS_CC, "Could not size shared memory %s: %s", name, strerror(errno));
+            close(fd);
+            shm_unlink(name);
+            return NULL;
+        }
+    } else {
+        if (fstat(fd, &st) != 0) {
+            zend_throw_exception_ex(opencv_ce_cvexception, errno TSRMLS_CC, "Could not stat shared memory %s: %s", name, strerror(errno));
+            close(fd);
+            return NULL;
+        }
+        length = st.st_size;
+    }
+
+    addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        zend_throw_exception_ex(opencv_ce_cvexception, errno TSRMLS_CC, "Could not map shared memory %s: %s", name, strerror(errno));
+        return NULL;
+    }
+
+    mapping = (php_opencv_mapping *) emalloc(sizeof(php_opencv_mapping));
+    mapping->addr = addr;
+    mapping->length = length;
+    mapping->name = estrdup(name);
+    return mapping;
+}
+
+/* Wraps a mapped segment in a SharedImage object, releasing the mapping
+   if that fails */
+static void php_opencv_shm_make_zval(php_opencv_mapping *mapping, zval *return_value TSRMLS_DC)
+{
+    opencv_image_object *image_object;
+    IplImage *image;
+
+    image = php_opencv_raw_image(mapping TSRMLS_CC);
+    if (image == NULL) {
+        php_opencv_mapping_release(mapping TSRMLS_CC);
+        return;
+    }
+    php_opencv_make_image_zval_ex(image, return_value, opencv_ce_sharedimage TSRMLS_CC);
+    image_object = (opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC);
+    php_opencv_image_set_backing(image_object, mapping, php_opencv_mapping_release TSRMLS_CC);
+}
+
+/* Creates a new segment for an image of the given shape */
+static php_opencv_mapping *php_opencv_shm_create(const char *name, int width, int height, int depth, int channels TSRMLS_DC)
+{
+    php_opencv_raw_header header;
+    php_opencv_mapping *mapping;
+    size_t length;
+
+    if (width <= 0 || height <= 0 || width > INT_MAX || height > INT_MAX || !php_opencv_image_format_valid(depth, channels)) {
+        zend_throw_exception(opencv_ce_cvexception, "Invalid size, depth or channels for a shared image", 0 TSRMLS_CC);
+        return NULL;
+    }
+
+    length = php_opencv_raw_init(&header, PHP_OPENCV_RAW_IMAGE, width, height, depth, channels, channels * ((depth & 255) >> 3));
+    mapping = php_opencv_shm_map(name, length TSRMLS_CC);
+    if (mapping == NULL) {
+        return NULL;
+    }
+    memcpy(mapping->addr, &header, sizeof(header));
+    return mapping;
+}
+
+/* {{{ proto void __construct()
+   Shared images are made with SharedImage::create() or SharedImage::open() */
+PHP_METHOD(OpenCV_SharedImage, __construct)
+{
+    zend_throw_exception(opencv_ce_cvexception, "OpenCV\\SharedImage must be made with create(), fromImage() or open()", 0 TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto SharedImage create(string name, int width, int height, int depth, int channels)
+       Creates a named POSIX shared memory segment holding an image. Other
+       processes can then open() it by name and see the same pixels. */
+PHP_METHOD(OpenCV_SharedImage, create)
+{
+    char *name;
+    int name_len;
+    long width, height, depth, channels;
+    php_opencv_mapping *mapping;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "sllll", &name, &name_len, &width, &height, &depth, &channels) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    mapping = php_opencv_shm_create(name, width, height, depth, channels TSRMLS_CC);
+    if (mapping == NULL) {
+        return;
+    }
+    php_opencv_shm_make_zval(mapping, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto SharedImage fromImage(string name, Image image)
+       Creates a named shared image holding a copy of the image, or of its
+       ROI if one is set */
+PHP_METHOD(OpenCV_SharedImage, fromImage)
+{
+    char *name;
+    int name_len;
+    zval *image_zval;
+    opencv_image_object *image_object;
+    php_opencv_mapping *mapping;
+    IplImage *src, *dst;
+    CvSize size;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "sO", &name, &name_len, &image_zval, opencv_ce_image) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    src = image_object->cvptr;
+    size = cvGetSize(src);
+
+    mapping = php_opencv_shm_create(name, size.width, size.height, src->depth, src->nChannels TSRMLS_CC);
+    if (mapping == NULL) {
+        return;
+    }
+    ((php_opencv_raw_header *) mapping->addr)->origin = src->origin;
+
+    php_opencv_shm_make_zval(mapping, return_value TSRMLS_CC);
+    dst = ((opencv_image_object *) zend_object_store_get_object(return_value TSRMLS_CC))->cvptr;
+    cvCopy(src, dst);
+    php_opencv_throw_exception(TSRMLS_C);
+}
+/* }}} */
+
+/* {{{ proto SharedImage open(string name)
+       Maps a shared image created by another process. Writes are seen by
+       every process that has it open. */
+PHP_METHOD(OpenCV_SharedImage, open)
+{
+    char *name;
+    int name_len;
+    php_opencv_mapping *mapping;
+
+    PHP_OPENCV_ERROR_HANDLING();
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "s", &name, &name_len) == FAILURE) {
+        PHP_OPENCV_RESTORE_ERRORS();
+        return;
+    }
+    PHP_OPENCV_RESTORE_ERRORS();
+
+    mapping = php_opencv_shm_map(name, 0 TSRMLS_CC);
+    if (mapping == NULL) {
+        return;
+    }
+    if (php_opencv_raw_check((php_opencv_raw_header *) mapping->addr, mapping->length, PHP_OPENCV_RAW_IMAGE TSRMLS_CC) == FAILURE) {
+        php_opencv_mapping_release(mapping TSRMLS_CC);
+        return;
+    }
+    php_opencv_shm_make_zval(mapping, return_value TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto bool unlink(string name)
+       Removes a shared image's name. Processes that have it open keep their
+       mapping until they release it. */
+PHP_METHOD(OpenCV_SharedImage, unlink)
+{
+    char *name;
+    int name_len;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "s", &name, &name_len) == FAILURE) {
+        return;
+    }
+
+    RETURN_BOOL(shm_unlink(name) == 0);
+}
+/* }}} */
+
+/* {{{ proto string getName() */
+PHP_METHOD(OpenCV_SharedImage, getName)
+{
+    zval *image_zval;
+    opencv_image_object *image_object;
+
+    if (zend_parse_method_parameters(ZEND_NUM_ARGS() TSRMLS_CC, getThis(), "O", &image_zval, opencv_ce_sharedimage) == FAILURE) {
+        return;
+    }
+
+    image_object = opencv_image_object_get(image_zval TSRMLS_CC);
+    RETURN_STRING(((php_opencv_mapping *) image_object->backing)->name, 1);
+}
+/* }}} */
+
+/* {{{ opencv_sharedimage_methods[] */
+const zend_function_entry opencv_sharedimage_methods[] = {
+    PHP_ME(OpenCV_SharedImage, __construct, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
+    PHP_ME(OpenCV_SharedImage, create, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_SharedImage, fromImage, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_SharedImage, open, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_SharedImage, unlink, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_SharedImage, getName, NULL, ZEND_ACC_PUBLIC)
+    {NULL, NULL, NULL}
+};
+/* }}} */
+
+/* {{{ PHP_MINIT_FUNCTION */
+PHP_MINIT_FUNCTION(opencv_shared)
+{
+    zend_class_entry ce;
+
+    INIT_NS_CLASS_ENTRY(ce, "OpenCV", "SharedImage", opencv_sharedimage_methods);
+    opencv_ce_sharedimage = zend_register_internal_class_ex(&ce, opencv_ce_image, NULL TSRMLS_CC);
+    opencv_ce_sharedimage->ce_flags |= ZEND_ACC_FINAL_CLASS;
+
+    return SUCCESS;
+}
+/* }}} */
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
@@ -0,0 +1,333 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 5                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2010 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Author: Michael Maclean <mgdm@php.net>                               |
+  +----------------------------------------------------------------------+
+*/
+
+/* $Id$ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php_opencv.h"
+
+#include <time.h>
+#include <algorithm>
+
+extern "C" {
+#include "ext/standard/info.h"
+}
+
+/* Calls are timed for the most recent this many calls of each method, which
+   the percentiles are taken over */
+#define PHP_OPENCV_STATS_SAMPLES 512
+
+zend_class_entry *opencv_ce_stats;
+
+typedef struct _php_opencv_stat {
+    unsigned long calls;
+    double total;
+    double max;
+    double samples[PHP_OPENCV_STATS_SAMPLES];
+} php_opencv_stat;
+
+/* Every call into the extension goes through this hook, which only costs a
+   flag check while opencv.stats_enabled is off. Timings are kept per worker
+   process (or thread) until Stats::reset() is called. */
+#if PHP_VERSION_ID >= 50500
+#define PHP_OPENCV_EXECUTE_INTERNAL_DC zend_execute_data *execute_data_ptr, zend_fcall_info *fci, int return_value_used TSRMLS_DC
+#define PHP_OPENCV_EXECUTE_INTERNAL_CC execute_data_ptr, fci, return_value_used TSRMLS_CC
+#else
+#define PHP_OPENCV_EXECUTE_INTERNAL_DC zend_execute_data *execute_data_ptr, int return_value_used TSRMLS_DC
+#define PHP_OPENCV_EXECUTE_INTERNAL_CC execute_data_ptr, return_value_used TSRMLS_CC
+#endif
+
+static void (*php_opencv_original_execute_internal)(PHP_OPENCV_EXECUTE_INTERNAL_DC);
+
+static double php_opencv_stats_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void php_opencv_stats_record(zend_function *func, double elapsed TSRMLS_DC)
+{
+    php_opencv_stat *stat, empty;
+    char key[256];
+    int key_len;
+
+    if (OPENCV_G(stats) == NULL) {
+        OPENCV_G(stats) = (HashTable *) pemalloc(sizeof(HashTable), 1);
+        zend_hash_init(OPENCV_G(stats), 32, NULL, NULL, 1);
+    }
+
+    key_len = snprintf(key, sizeof(key), "%s::%s", func->common.scope ? func->common.scope->name : "", func->common.function_name);
+    if (key_len >= (int) sizeof(key)) {
+        key_len = sizeof(key) - 1;
+    }
+
+    if (zend_hash_find(OPENCV_G(stats), key, key_len + 1, (void **) &stat) == FAILURE) {
+        memset(&empty, 0, sizeof(empty));
+        zend_hash_add(OPENCV_G(stats), key, key_len + 1, &empty, sizeof(empty), (void **) &stat);
+    }
+
+    stat->samples[stat->calls % PHP_OPENCV_STATS_SAMPLES] = elapsed;
+    stat->calls++;
+    stat->total += elapsed;
+    if (elapsed > stat->max) {
+        stat->max = elapsed;
+    }
+}
+
+static void php_opencv_stats_execute_internal(PHP_OPENCV_EXECUTE_INTERNAL_DC)
+{
+    zend_function *func = execute_data_ptr->function_state.function;
+    double start;
+
+    /* The Stats methods aren't timed, so they never show up in their own
+       report */
+    if (!OPENCV_G(stats_enabled) || func->type != ZEND_INTERNAL_FUNCTION || func->internal_function.module != &opencv_module_entry
+            || func->common.scope == opencv_ce_stats) {
+        if (php_opencv_original_execute_internal != NULL) {
+            php_opencv_original_execute_internal(PHP_OPENCV_EXECUTE_INTERNAL_CC);
+        } else {
+            execute_internal(PHP_OPENCV_EXECUTE_INTERNAL_CC);
+        }
+        return;
+    }
+
+    start = php_opencv_stats_now();
+    if (php_opencv_original_execute_internal != NULL) {
+        php_opencv_original_execute_internal(PHP_OPENCV_EXECUTE_INTERNAL_CC);
+    } else {
+        execute_internal(PHP_OPENCV_EXECUTE_INTERNAL_CC);
+    }
+    php_opencv_stats_record(func, php_opencv_stats_now() - start TSRMLS_CC);
+}
+
+/* {{{ php_opencv_stats_image_memory
+   Adds to (or with a negative count, takes from) the memory held by live
+   images */
+PHP_OPENCV_API void php_opencv_stats_image_memory(long bytes TSRMLS_DC)
+{
+    OPENCV_G(stats_images) += bytes > 0 ? 1 : -1;
+    OPENCV_G(stats_image_bytes) += bytes;
+    if (OPENCV_G(stats_image_bytes) > OPENCV_G(stats_image_peak)) {
+        OPENCV_G(stats_image_peak) = OPENCV_G(stats_image_bytes);
+    }
+}
+/* }}} */
+
+/* {{{ php_opencv_stats_free
+   Frees the per-method timings */
+PHP_OPENCV_API void php_opencv_stats_free(HashTable **stats)
+{
+    if (*stats != NULL) {
+        zend_hash_destroy(*stats);
+        pefree(*stats, 1);
+        *stats = NULL;
+    }
+}
+/* }}} */
+
+/* Returns the pth percentile of the recorded samples */
+static double php_opencv_stats_percentile(const std::vector<double> &sorted, int p)
+{
+    return sorted[(sorted.size() - 1) * p / 100];
+}
+
+/* {{{ proto void __construct()
+   OpenCV\Stats only has static methods */
+PHP_METHOD(OpenCV_Stats, __construct)
+{
+    zend_throw_exception(opencv_ce_cvexception, "OpenCV\\Stats cannot be constructed", 0 TSRMLS_CC);
+}
+/* }}} */
+
+/* {{{ proto bool isEnabled()
+       Returns whether calls are being timed, as set by opencv.stats_enabled */
+PHP_METHOD(OpenCV_Stats, isEnabled)
+{
+    if (zend_parse_parameters_none() == FAILURE) {
+        return;
+    }
+    RETURN_BOOL(OPENCV_G(stats_enabled));
+}
+/* }}} */
+
+/* {{{ proto array get()
+       Returns the calls, total, max and p50/p95/p99 times in seconds for each
+       method called since the last reset, along with the memory held by live
+       images and the state of the image pool */
+PHP_METHOD(OpenCV_Stats, get)
+{
+    zval *methods, *method, *memory, *pool;
+    php_opencv_stat *stat;
+    HashPosition pos;
+    char *key;
+    uint key_len;
+    ulong index;
+
+    if (zend_parse_parameters_none() == FAILURE) {
+        return;
+    }
+
+    array_init(return_value);
+
+    MAKE_STD_ZVAL(methods);
+    array_init(methods);
+    if (OPENCV_G(stats) != NULL) {
+        for (zend_hash_internal_pointer_reset_ex(OPENCV_G(stats), &pos);
+                zend_hash_get_current_data_ex(OPENCV_G(stats), (void **) &stat, &pos) == SUCCESS;
+                zend_hash_move_forward_ex(OPENCV_G(stats), &pos)) {
+            std::vector<double> sorted(stat->samples, stat->samples + MIN(stat->calls, (unsigned long) PHP_OPENCV_STATS_SAMPLES));
+
+            std::sort(sorted.begin(), sorted.end());
+            zend_hash_get_current_key_ex(OPENCV_G(stats), &key, &key_len, &index, 0, &pos);
+
+            MAKE_STD_ZVAL(method);
+            array_init(method);
+            add_assoc_long(method, "calls", stat->calls);
+            add_assoc_double(method, "total", stat->total);
+            add_assoc_double(method, "max", stat->max);
+            add_assoc_double(method, "p50", php_opencv_stats_percentile(sorted, 50));
+            add_assoc_double(method, "p95", php_opencv_stats_percentile(sorted, 95));
+            add_assoc_double(method, "p99", php_opencv_stats_percentile(sorted, 99));
+            add_assoc_zval_ex(methods, key, key_len, method);
+        }
+    }
+    add_assoc_zval(return_value, "methods", methods);
+
+    MAKE_STD_ZVAL(memory);
+    array_init(memory);
+    add_assoc_long(memory, "images", OPENCV_G(stats_images));
+    add_assoc_long(memory, "bytes", OPENCV_G(stats_image_bytes));
+    add_assoc_long(memory, "peak", OPENCV_G(stats_image_peak));
+    add_assoc_zval(return_value, "memory", memory);
+
+    MAKE_STD_ZVAL(pool);
+    array_init(pool);
+    add_assoc_long(pool, "images", OPENCV_G(image_pool_count));
+    add_assoc_long(pool, "bytes", (long) OPENCV_G(image_pool_bytes));
+    add_assoc_long(pool, "reused", (long) OPENCV_G(image_pool_hits));
+    add_assoc_long(pool, "allocated", (long) OPENCV_G(image_pool_misses));
+    add_assoc_long(pool, "freed", (long) OPENCV_G(image_pool_discards));
+    add_assoc_zval(return_value, "pool", pool);
+}
+/* }}} */
+
+/* {{{ proto void reset()
+       Clears the method timings and starts the peak memory from the current
+       level, so each request (or each flush to a metrics system) can report
+       only its own calls */
+PHP_METHOD(OpenCV_Stats, reset)
+{
+    if (zend_parse_parameters_none() == FAILURE) {
+        return;
+    }
+
+    php_opencv_stats_free(&OPENCV_G(stats));
+    OPENCV_G(stats_image_peak) = OPENCV_G(stats_image_bytes);
+}
+/* }}} */
+
+/* {{{ php_opencv_stats_info
+   Adds the timings to phpinfo() */
+PHP_OPENCV_API void php_opencv_stats_info(TSRMLS_D)
+{
+    php_opencv_stat *stat;
+    HashPosition pos;
+    char *key, buf[64];
+    uint key_len;
+    ulong index;
+
+    php_info_print_table_start();
+    php_info_print_table_header(2, "Statistics", "Value");
+    php_info_print_table_row(2, "Enabled", OPENCV_G(stats_enabled) ? "Yes" : "No");
+    snprintf(buf, sizeof(buf), "%ld", OPENCV_G(stats_images));
+    php_info_print_table_row(2, "Live images", buf);
+    snprintf(buf, sizeof(buf), "%ld", OPENCV_G(stats_image_bytes));
+    php_info_print_table_row(2, "Live image bytes", buf);
+    snprintf(buf, sizeof(buf), "%ld", OPENCV_G(stats_image_peak));
+    php_info_print_table_row(2, "Peak image bytes", buf);
+    php_info_print_table_end();
+
+    if (OPENCV_G(stats) == NULL || zend_hash_num_elements(OPENCV_G(stats)) == 0) {
+        return;
+    }
+
+    php_info_print_table_start();
+    php_info_print_table_header(3, "Method", "Calls", "Total time (ms)");
+    for (zend_hash_internal_pointer_reset_ex(OPENCV_G(stats), &pos);
+            zend_hash_get_current_data_ex(OPENCV_G(stats), (void **) &stat, &pos) == SUCCESS;
+            zend_hash_move_forward_ex(OPENCV_G(stats), &pos)) {
+        char calls[32];
+
+        zend_hash_get_current_key_ex(OPENCV_G(stats), &key, &key_len, &index, 0, &pos);
+        snprintf(calls, sizeof(calls), "%lu", stat->calls);
+        snprintf(buf, sizeof(buf), "%.3f", stat->total * 1000);
+        php_info_print_table_row(3, key, calls, buf);
+    }
+    php_info_print_table_end();
+}
+/* }}} */
+
+/* {{{ opencv_stats_methods[] */
+const zend_function_entry opencv_stats_methods[] = {
+    PHP_ME(OpenCV_Stats, __construct, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
+    PHP_ME(OpenCV_Stats, isEnabled, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Stats, get, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    PHP_ME(OpenCV_Stats, reset, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+    {NULL, NULL, NULL}
+};
+/* }}} */
+
+/* {{{ PHP_MINIT_FUNCTION */
+PHP_MINIT_FUNCTION(opencv_stats)
+{
+    zend_class_entry ce;
+
+    INIT_NS_CLASS_ENTRY(ce, "OpenCV", "Stats", opencv_stats_methods);
+    opencv_ce_stats = zend_register_internal_class(&ce TSRMLS_CC);
+    opencv_ce_stats->ce_flags |= ZEND_ACC_FINAL_CLASS;
+
+    php_opencv_original_execute_internal = zend_execute_internal;
+    zend_execute_internal = php_opencv_stats_execute_internal;
+
+    return SUCCESS;
+}
+/* }}} */
+
+/* {{{ PHP_MSHUTDOWN_FUNCTION */
+PHP_MSHUTDOWN_FUNCTION(opencv_stats)
+{
+    if (zend_execute_internal == php_opencv_stats_execute_internal) {
+        zend_execute_internal = php_opencv_original_execute_internal;
+    }
+    return SUCCESS;
+}
+/* }}} */
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
@@ -58,8 +58,26 @@ extern zend_module_entry opencv_module_entry;
 	zend_restore_error_handling(&opencv_original_error_handling TSRMLS_CC); \
 } while(0)
 
+/* The property handlers gained a literal key in 5.4 and a fetch type for
+   get_property_ptr_ptr in 5.5 */
+#if PHP_VERSION_ID >= 50400
+#	define PHP_OPENCV_PROPERTY_KEY_DC , const zend_literal *key
+#	define PHP_OPENCV_PROPERTY_KEY_CC , key
+#else
+#	define PHP_OPENCV_PROPERTY_KEY_DC
+#	define PHP_OPENCV_PROPERTY_KEY_CC
+#endif
+#if PHP_VERSION_ID >= 50500
+#	define PHP_OPENCV_PROPERTY_PTR_DC , int type PHP_OPENCV_PROPERTY_KEY_DC
+#	define PHP_OPENCV_PROPERTY_PTR_CC , type PHP_OPENCV_PROPERTY_KEY_CC
+#else
+#	define PHP_OPENCV_PROPERTY_PTR_DC PHP_OPENCV_PROPERTY_KEY_DC
+#	define PHP_OPENCV_PROPERTY_PTR_CC PHP_OPENCV_PROPERTY_KEY_CC
+#endif
+
 #include <opencv2/opencv.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <stdint.h>
 
 using namespace cv;
 
@@ -69,7 +87,14 @@ PHP_MINIT_FUNCTION(opencv_mat);
 PHP_MINIT_FUNCTION(opencv_image);
 PHP_MINIT_FUNCTION(opencv_histogram);
 PHP_MINIT_FUNCTION(opencv_capture);
+PHP_MINIT_FUNCTION(opencv_cascade);
+PHP_MINIT_FUNCTION(opencv_pipeline);
+PHP_MINIT_FUNCTION(opencv_batch);
+PHP_MINIT_FUNCTION(opencv_shared);
+PHP_MINIT_FUNCTION(opencv_stats);
 PHP_MSHUTDOWN_FUNCTION(opencv);
+PHP_MSHUTDOWN_FUNCTION(opencv_cascade);
+PHP_MSHUTDOWN_FUNCTION(opencv_stats);
 PHP_MINFO_FUNCTION(opencv);
 PHP_RINIT_FUNCTION(opencv);
 
@@ -77,19 +102,62 @@ extern zend_object_handlers opencv_std_object_handlers;
 extern zend_class_entry *opencv_ce_cvexception;
 extern zend_class_entry *opencv_ce_cvmat;
 extern zend_class_entry *opencv_ce_image;
+extern zend_class_entry *opencv_ce_sharedimage;
 extern zend_class_entry *opencv_ce_histogram;
+extern zend_class_entry *opencv_ce_capture;
+extern zend_class_entry *opencv_ce_frameiterator;
+extern zend_class_entry *opencv_ce_cascade;
+extern zend_class_entry *opencv_ce_pipeline;
+extern zend_class_entry *opencv_ce_batch;
+extern zend_class_entry *opencv_ce_stats;
+
+/* Shared by Mat and Image, which read their properties from the native object */
+extern zend_object_handlers opencv_mat_object_handlers;
+
+ZEND_BEGIN_MODULE_GLOBALS(opencv)
+	long cascade_cache_size;
+	long batch_threads;
+	CvMemStorage *haar_storage;
+	long image_pool_size;
+	long image_pool_memory;
+	IplImage **image_pool;
+	int image_pool_count;
+	int image_pool_capacity;
+	size_t image_pool_bytes;
+	unsigned long image_pool_hits;
+	unsigned long image_pool_misses;
+	unsigned long image_pool_discards;
+	zend_bool stats_enabled;
+	HashTable *stats;
+	long stats_images;
+	long stats_image_bytes;
+	long stats_image_peak;
+ZEND_END_MODULE_GLOBALS(opencv)
 
+ZEND_EXTERN_MODULE_GLOBALS(opencv)
+
+
+/* Frees whatever memory an image or Mat header was wrapped around */
+typedef void (*php_opencv_release_func)(void *backing TSRMLS_DC);
 
 typedef struct _opencv_mat_object {
 	zend_object std;
 	zend_bool constructed;
 	Mat *cvptr;
+	/* Set when cvptr refers to memory owned by something else */
+	void *backing;
+	php_opencv_release_func release_backing;
 } opencv_mat_object;
 
 typedef struct _opencv_image_object {
 	zend_object std;
 	zend_bool constructed;
 	IplImage *cvptr;
+	/* Set when cvptr is only a header over memory owned by something else */
+	void *backing;
+	php_opencv_release_func release_backing;
+	/* The bytes counted towards the image memory statistics */
+	size_t stats_bytes;
 } opencv_image_object;
 
 typedef struct _opencv_histogram_object {
@@ -98,18 +166,171 @@ typedef struct _opencv_histogram_object {
 	CvHistogram *cvptr;
 } opencv_histogram_object;
 
+/* Frames decoded ahead of time on a background thread */
+typedef struct _php_opencv_prefetch php_opencv_prefetch;
+
 typedef struct _opencv_capture_object {
 	zend_object std;
 	zend_bool constructed;
 	CvCapture* cvptr;
+	php_opencv_prefetch *prefetch;
 } opencv_capture_object;
 
+typedef struct _opencv_frame_iterator_object {
+	zend_object std;
+	zval *capture;
+	long step;
+	double start_msec;
+	double end_msec;
+	zend_bool seek;
+	zend_bool started;
+	long next_frame;
+	long key;
+	zval *current;
+} opencv_frame_iterator_object;
+
+/* A loaded Haar cascade, shared between the module-wide cache and any
+   OpenCV\CascadeClassifier objects using it */
+typedef struct _php_opencv_cascade_entry php_opencv_cascade_entry;
+
+typedef struct _opencv_cascade_object {
+	zend_object std;
+	zend_bool constructed;
+	php_opencv_cascade_entry *entry;
+} opencv_cascade_object;
+
+/* Tuning for a Haar detection run */
+typedef struct _php_opencv_haar_params {
+	double scale_factor;
+	int min_neighbors;
+	int flags;
+	CvSize min_size;
+	CvSize max_size;
+	zend_bool equalize;
+} php_opencv_haar_params;
+
+/* A single step of an OpenCV\Pipeline */
+typedef struct _php_opencv_pipeline_op {
+	int type;
+	double params[5];
+} php_opencv_pipeline_op;
+
+/* The intermediate images for running a pipeline, kept between runs so
+   frames of the same shape don't allocate. These are only ever touched by
+   native code, so they can be used from worker threads. */
+typedef struct _php_opencv_pipeline_buffers {
+	int count;
+	IplImage **images;
+	IplImage **scratch;
+	IplImage *result;
+	char error[256];
+} php_opencv_pipeline_buffers;
+
+typedef struct _opencv_pipeline_object {
+	zend_object std;
+	zend_bool constructed;
+	php_opencv_pipeline_op *ops;
+	int op_count;
+	php_opencv_pipeline_buffers buffers;
+} opencv_pipeline_object;
+
+/* The header at the start of a shared or mapped raw image. The pixel data
+   follows at data_offset, with row_size bytes per row. */
+#define PHP_OPENCV_RAW_MAGIC "PHPCVRAW"
+#define PHP_OPENCV_RAW_VERSION 1
+#define PHP_OPENCV_RAW_IMAGE 1
+#define PHP_OPENCV_RAW_MAT 2
+
+typedef struct _php_opencv_raw_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t kind;
+	int32_t width;
+	int32_t height;
+	int32_t depth;
+	int32_t channels;
+	int32_t origin;
+	int32_t reserved;
+	uint64_t row_size;
+	uint64_t data_offset;
+} php_opencv_raw_header;
+
+/* A region of memory mapped from a shared memory segment or a file */
+typedef struct _php_opencv_mapping {
+	void *addr;
+	size_t length;
+	char *name;
+} php_opencv_mapping;
+
+/* A location in a template matching response map */
+typedef struct _php_opencv_peak {
+	int x;
+	int y;
+	double score;
+} php_opencv_peak;
+
+/* A hit from multi-scale template matching */
+typedef struct _php_opencv_match {
+	int x;
+	int y;
+	int width;
+	int height;
+	double score;
+	double scale;
+} php_opencv_match;
+
 
 PHP_OPENCV_API extern void php_opencv_throw_exception(TSRMLS_D);
+PHP_OPENCV_API void php_opencv_throw_cv_exception(const cv::Exception &e TSRMLS_DC);
 PHP_OPENCV_API void php_opencv_basedir_check(const char *filename TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_array_to_params(zval *params_zval, std::vector<int> &params TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_release_zval(void *backing TSRMLS_DC);
+PHP_OPENCV_API zval *php_opencv_option_find(zval *options_zval, const char *key);
+PHP_OPENCV_API long php_opencv_option_long(zval *options_zval, const char *key, long def);
+PHP_OPENCV_API double php_opencv_option_double(zval *options_zval, const char *key, double def);
+PHP_OPENCV_API CvSize php_opencv_option_size(zval *options_zval, const char *key, CvSize def);
 PHP_OPENCV_API extern opencv_image_object* opencv_image_object_get(zval *zobj TSRMLS_DC);
 PHP_OPENCV_API extern opencv_histogram_object* opencv_histogram_object_get(zval *zobj TSRMLS_DC);
+PHP_OPENCV_API IplImage *php_opencv_image_create(CvSize size, int depth, int channels TSRMLS_DC);
+PHP_OPENCV_API IplImage *php_opencv_image_clone(const IplImage *src TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_image_release(IplImage **image TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_image_pool_clear(zend_opencv_globals *opencv_globals);
 PHP_OPENCV_API zval *php_opencv_make_image_zval(IplImage *image, zval *image_zval TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_image_set_backing(opencv_image_object *image_obj, void *backing, php_opencv_release_func release TSRMLS_DC);
+PHP_OPENCV_API int php_opencv_image_format_valid(int depth, int channels);
+PHP_OPENCV_API void php_opencv_stats_image_memory(long bytes TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_stats_free(HashTable **stats);
+PHP_OPENCV_API void php_opencv_stats_info(TSRMLS_D);
+PHP_OPENCV_API zval *php_opencv_make_mat_zval(const cv::Mat &mat, zval *mat_zval TSRMLS_DC);
+PHP_OPENCV_API zval *php_opencv_make_image_zval_ex(IplImage *image, zval *image_zval, zend_class_entry *ce TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_mat_get_bytes(const cv::Mat &mat, long start_row, long row_count, zval *return_value TSRMLS_DC);
+PHP_OPENCV_API int php_opencv_mat_set_bytes(cv::Mat &mat, const char *data, int data_len, long start_row TSRMLS_DC);
+PHP_OPENCV_API php_opencv_cascade_entry *php_opencv_cascade_acquire(const char *filename TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_cascade_release(php_opencv_cascade_entry *entry);
+PHP_OPENCV_API int php_opencv_cascade_cache_count(void);
+PHP_OPENCV_API void php_opencv_haar_params_init(php_opencv_haar_params *params, zval *options_zval TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_haar_detect(IplImage *image, php_opencv_cascade_entry *entry, const php_opencv_haar_params *params, zval *return_value TSRMLS_DC);
+PHP_OPENCV_API IplImage *php_opencv_pipeline_exec(const php_opencv_pipeline_op *ops, int op_count, IplImage *src, php_opencv_pipeline_buffers *buffers);
+PHP_OPENCV_API IplImage *php_opencv_pipeline_take_result(php_opencv_pipeline_buffers *buffers);
+PHP_OPENCV_API void php_opencv_pipeline_buffers_free(php_opencv_pipeline_buffers *buffers);
+PHP_OPENCV_API size_t php_opencv_raw_init(php_opencv_raw_header *header, int kind, int width, int height, int depth, int channels, size_t elem_size);
+PHP_OPENCV_API int php_opencv_raw_check(const php_opencv_raw_header *header, size_t length, int kind TSRMLS_DC);
+PHP_OPENCV_API IplImage *php_opencv_raw_image(php_opencv_mapping *mapping TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_mapping_release(void *backing TSRMLS_DC);
+PHP_OPENCV_API php_opencv_mapping *php_opencv_raw_map_file(const char *filename, int kind TSRMLS_DC);
+PHP_OPENCV_API int php_opencv_raw_write_file(const char *filename, php_opencv_raw_header *header, const cv::Mat &data TSRMLS_DC);
+PHP_OPENCV_API IplImage *php_opencv_load_scaled(const char *filename, int max_width, int max_height, int mode, zend_bool enlarge, int interpolation);
+PHP_OPENCV_API int php_opencv_match_minimises(int mode);
+PHP_OPENCV_API void php_opencv_find_peaks(cv::Mat &map, double threshold, int max_count, int radius, bool minima, std::vector<php_opencv_peak> &peaks);
+PHP_OPENCV_API void php_opencv_peaks_to_array(const std::vector<php_opencv_peak> &peaks, zval *return_value);
+PHP_OPENCV_API void php_opencv_match_multiscale(const cv::Mat &image, const cv::Mat &templ, int mode, const std::vector<double> &scales, int levels, double threshold, int max_count, int margin, std::vector<php_opencv_match> &matches);
+
+/* Native work spread over a pool of threads. Task functions must not call
+   into the engine; worker is in [0, thread_count) and can be used to index
+   per-thread state. */
+typedef void (*php_opencv_task_func)(void *ctx, int task, int worker);
+PHP_OPENCV_API int php_opencv_thread_count(long requested TSRMLS_DC);
+PHP_OPENCV_API void php_opencv_parallel_run(int task_count, int thread_count, php_opencv_task_func func, void *ctx);
 
 
 #ifdef ZTS
@@ -0,0 +1,50 @@
+--TEST--
+Encode and decode images in memory
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Mat as Mat;
+
+$image = new Image(64, 48, Image::DEPTH_8U, 3);
+$png = $image->encode("png", array(Image::IMWRITE_PNG_COMPRESSION, 1));
+var_dump(substr($png, 1, 3));
+
+$decoded = Image::decode($png, Image::LOAD_IMAGE_UNCHANGED);
+var_dump($decoded->width, $decoded->height, $decoded->nChannels);
+
+$mat = Mat::decode($image->encode(".png"), Image::LOAD_IMAGE_GRAYSCALE);
+var_dump($mat->cols, $mat->rows, $mat->channels);
+var_dump(substr($mat->encode("png"), 1, 3));
+
+try {
+	Image::decode("not an image");
+} catch (OpenCV\Exception $e) {
+	echo "caught\n";
+}
+
+try {
+	$image->encode("xyz");
+} catch (OpenCV\Exception $e) {
+	echo "caught\n";
+}
+
+try {
+	$mat->encode("xyz");
+} catch (OpenCV\Exception $e) {
+	echo "caught\n";
+}
+?>
+--EXPECT--
+string(3) "PNG"
+int(64)
+int(48)
+int(3)
+int(64)
+int(48)
+int(1)
+string(3) "PNG"
+caught
+caught
+caught
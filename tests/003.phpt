@@ -0,0 +1,46 @@
+--TEST--
+Run a multi-step pipeline natively
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Pipeline as Pipeline;
+
+$pipeline = new Pipeline();
+$pipeline->convertColor(Image::BGR2GRAY, 1)
+	->smooth(Image::GAUSSIAN, 5)
+	->canny(10, 50, 3)
+	->dilate(2)
+	->pyrDown();
+var_dump($pipeline->count());
+
+$image = new Image(320, 240, Image::DEPTH_8U, 3);
+for ($i = 0; $i < 3; $i++) {
+	$result = $pipeline->run($image);
+	var_dump($result->width, $result->height, $result->nChannels);
+}
+
+$dst = new Image(160, 120, Image::DEPTH_8U, 1);
+var_dump($pipeline->run($image, $dst) === $dst);
+
+try {
+	$empty = new Pipeline();
+	$empty->run($image);
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+?>
+--EXPECT--
+int(5)
+int(160)
+int(120)
+int(1)
+int(160)
+int(120)
+int(1)
+int(160)
+int(120)
+int(1)
+bool(true)
+The pipeline has no steps
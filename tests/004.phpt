@@ -0,0 +1,76 @@
+--TEST--
+Find peaks and template matches natively
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+
+/* An 8x8 greyscale map with peaks of 200 at (2, 1) and 150 at (6, 5),
+   and a weaker 180 right next to the first one */
+$pixels = array_fill(0, 64, 10);
+$pixels[1 * 8 + 2] = 200;
+$pixels[1 * 8 + 3] = 180;
+$pixels[5 * 8 + 6] = 150;
+$pgm = "P5\n8 8\n255\n" . call_user_func_array('pack', array_merge(array('C*'), $pixels));
+$map = Image::decode($pgm, Image::LOAD_IMAGE_GRAYSCALE);
+
+$extremes = $map->minMaxLoc();
+var_dump($extremes['max'], $extremes['maxLoc']);
+
+foreach ($map->findPeaks(100, 5, 1) as $peak) {
+	printf("%d,%d %.0f\n", $peak['x'], $peak['y'], $peak['score']);
+}
+
+$template = Image::decode("P5\n2 2\n255\n" . pack('C*', 200, 180, 10, 10), Image::LOAD_IMAGE_GRAYSCALE);
+$best = $map->matchTemplateBest($template, Image::TM_SQDIFF);
+var_dump($best['x'], $best['y']);
+
+$hits = $map->matchTemplateMultiScale($template, Image::TM_SQDIFF, array('scales' => array(1.0, 2.0), 'maxCount' => 3, 'threshold' => 1));
+var_dump(count($hits), $hits[0]['x'], $hits[0]['y'], $hits[0]['scale']);
+
+/* With an ROI set, every match method reports image coordinates */
+$map->setImageROI(1, 0, 6, 4);
+$best = $map->matchTemplateBest($template, Image::TM_SQDIFF);
+$peaks = $map->matchTemplatePeaks($template, Image::TM_SQDIFF, 1, 1);
+$hits = $map->matchTemplateMultiScale($template, Image::TM_SQDIFF, array('levels' => 0, 'threshold' => 1));
+printf("%d,%d %d,%d %d,%d\n", $best['x'], $best['y'], $peaks[0]['x'], $peaks[0]['y'], $hits[0]['x'], $hits[0]['y']);
+$map->resetImageROI();
+
+/* Mismatched inputs throw instead of reaching OpenCV */
+$colour = new Image(2, 2, Image::DEPTH_8U, 3);
+$wide = new Image(2, 2, Image::DEPTH_16U, 1);
+foreach (array(
+	function () use ($map, $colour) { $map->matchTemplate($colour, Image::TM_SQDIFF); },
+	function () use ($map, $colour) { $map->matchTemplateBest($colour, Image::TM_SQDIFF); },
+	function () use ($map, $wide) { $map->matchTemplatePeaks($wide, Image::TM_SQDIFF, 1); },
+	function () use ($map, $template) { $map->matchTemplateBest($template, 42); },
+) as $call) {
+	try {
+		$call();
+	} catch (OpenCV\Exception $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+?>
+--EXPECT--
+float(200)
+array(2) {
+  ["x"]=>
+  int(2)
+  ["y"]=>
+  int(1)
+}
+2,1 200
+6,5 150
+int(2)
+int(1)
+int(1)
+int(2)
+int(1)
+float(1)
+2,1 2,1 2,1
+The image and template must both be 8 bit or 32 bit float, with the same number of channels
+The image and template must both be 8 bit or 32 bit float, with the same number of channels
+The image and template must both be 8 bit or 32 bit float, with the same number of channels
+Unknown template matching mode
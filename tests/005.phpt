@@ -0,0 +1,51 @@
+--TEST--
+Copy raw pixel data in and out of images
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Mat as Mat;
+
+/* 3 pixel wide rows are padded in memory, but not in the strings */
+$data = pack('C*', 1, 2, 3, 4, 5, 6);
+$image = Image::fromBytes($data, 3, 2, Image::DEPTH_8U, 1);
+var_dump($image->width, $image->height);
+var_dump(bin2hex($image->getBytes()));
+var_dump(bin2hex($image->getBytes(1, 1)));
+
+$image->setBytes(pack('C*', 7, 8, 9), 1);
+var_dump(bin2hex($image->getBytes()));
+
+$mat = Mat::fromBytes($image->getBytes(), 2, 3, 0);
+var_dump($mat->rows, $mat->cols, bin2hex($mat->getBytes()));
+
+try {
+	$image->setBytes("toolong", 0);
+} catch (OpenCV\Exception $e) {
+	echo "caught\n";
+}
+
+/* Depths and channel counts an image can't have are refused before
+   anything is allocated, even when the length happens to fit */
+foreach (array(array(24, 1), array(Image::DEPTH_8U, 5), array(Image::DEPTH_8U, 0)) as $format) {
+	try {
+		Image::fromBytes(str_repeat("\0", 6 * max(1, $format[1]) * 3), 3, 2, $format[0], $format[1]);
+	} catch (OpenCV\Exception $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+?>
+--EXPECT--
+int(3)
+int(2)
+string(12) "010203040506"
+string(6) "040506"
+string(12) "010203070809"
+int(2)
+int(3)
+string(12) "010203070809"
+caught
+Invalid size, depth or channels for an image
+Invalid size, depth or channels for an image
+Invalid size, depth or channels for an image
@@ -0,0 +1,73 @@
+--TEST--
+Save raw images and map them back in
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Mat as Mat;
+
+$file = tempnam(sys_get_temp_dir(), 'ocv');
+
+$data = pack('f*', 0.25, -1.5, 3.125, 1e-6, 42.0, -0.0);
+$image = Image::fromBytes($data, 3, 2, Image::DEPTH_32F, 1);
+$image->saveRaw($file);
+
+$mapped = Image::loadMapped($file);
+var_dump($mapped->width, $mapped->height, $mapped->depth == Image::DEPTH_32F);
+var_dump($mapped->getBytes() === $data);
+
+/* The mapping is private, so the file keeps the original data */
+$mapped->setBytes(pack('f*', 1, 2, 3), 0);
+var_dump(Image::loadMapped($file)->getBytes() === $data);
+
+$mat = Mat::fromBytes(pack('C*', 1, 2, 3, 4, 5, 6), 3, 2, 0);
+$mat->saveRaw($file);
+var_dump(bin2hex(Mat::loadMapped($file)->getBytes()));
+
+try {
+	Image::loadMapped($file);
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+
+/* Corrupt headers are refused rather than mapped */
+function patch_raw($file, $offset, $value)
+{
+	$raw = file_get_contents($file);
+	file_put_contents($file, substr_replace($raw, $value, $offset, strlen($value)));
+}
+$corrupt = array(
+	'depth' => array(24, pack('V', 24)),
+	'channels' => array(28, pack('V', 5)),
+	'short rows' => array(40, pack('VV', 4, 0)),
+	'no rows' => array(40, pack('VV', 0, 0)),
+	'overflowing rows' => array(40, pack('VV', 0, 0x40000000)),
+);
+foreach ($corrupt as $what => $patch) {
+	foreach (array('Image', 'Mat') as $class) {
+		if ($class == 'Image') {
+			$image->saveRaw($file);
+		} else {
+			$mat->saveRaw($file);
+		}
+		patch_raw($file, $patch[0], $patch[1]);
+		try {
+			call_user_func(array('OpenCV\\' . $class, 'loadMapped'), $file);
+			echo "$class with bad $what loaded\n";
+		} catch (OpenCV\Exception $e) {
+		}
+	}
+}
+echo "done\n";
+unlink($file);
+?>
+--EXPECT--
+int(3)
+int(2)
+bool(true)
+bool(true)
+bool(true)
+string(12) "010203040506"
+The raw data holds a Mat, not an Image
+done
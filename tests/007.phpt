@@ -0,0 +1,47 @@
+--TEST--
+Process Mats through the C++ API
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Mat as Mat;
+use OpenCV\Image as Image;
+
+$a = Mat::fromBytes(pack('C*', 10, 200, 30, 250), 2, 2, Mat::TYPE_8UC1);
+$b = Mat::fromBytes(pack('C*', 20, 100, 30, 10), 2, 2, Mat::TYPE_8UC1);
+
+var_dump(bin2hex($a->add($b)->getBytes()));
+var_dump(bin2hex($a->absdiff($b)->getBytes()));
+var_dump(bin2hex($a->threshold(100, 255, Mat::THRESH_BINARY)->getBytes()));
+
+/* Results can go into an existing Mat */
+$dst = new Mat(2, 2, Mat::TYPE_8UC1);
+$same = $a->subtract($b, $dst);
+var_dump($same === $dst, bin2hex($dst->getBytes()));
+
+$big = $a->resize(4, 4, Mat::INTER_NEAREST);
+var_dump($big->cols, $big->rows);
+
+$float = $a->convertTo(Mat::TYPE_32FC1, 0.5);
+var_dump(unpack('f', $float->getBytes(0, 1)));
+
+try {
+	$image = new Image(4, 4, Image::DEPTH_8U, 1);
+	$a->add($image);
+} catch (OpenCV\Exception $e) {
+	echo "caught\n";
+}
+?>
+--EXPECT--
+string(8) "1eff3cff"
+string(8) "0a6400f0"
+string(8) "00ff00ff"
+bool(true)
+string(8) "006400f0"
+int(4)
+int(4)
+array(1) {
+  [1]=>
+  float(5)
+}
+caught
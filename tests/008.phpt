@@ -0,0 +1,36 @@
+--TEST--
+Share pixels between Image and Mat
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Mat as Mat;
+
+$image = Image::fromBytes(pack('C*', 1, 2, 3, 4, 5, 6), 3, 2, Image::DEPTH_8U, 1);
+$mat = $image->toMat();
+var_dump($mat->cols, $mat->rows);
+
+/* Writes through the Mat show up in the image */
+$mat->setBytes(pack('C*', 9, 9, 9), 1);
+var_dump(bin2hex($image->getBytes()));
+
+/* The image stays alive as long as the Mat needs it */
+unset($image);
+var_dump(bin2hex($mat->getBytes()));
+
+$back = $mat->toImage();
+var_dump($back->width, $back->height, $back->depth == Image::DEPTH_8U);
+$back->setBytes(pack('C*', 7, 7, 7), 0);
+unset($mat);
+var_dump(bin2hex($back->getBytes()));
+?>
+--EXPECT--
+int(3)
+int(2)
+string(12) "010203090909"
+string(12) "010203090909"
+int(3)
+int(2)
+bool(true)
+string(12) "070707090909"
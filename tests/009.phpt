@@ -0,0 +1,35 @@
+--TEST--
+Views and regions share their parent's pixels
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Mat as Mat;
+
+$image = Image::fromBytes(pack('C*', 1, 2, 3, 4, 5, 6, 7, 8, 9), 3, 3, Image::DEPTH_8U, 1);
+$left = $image->view(0, 0, 2, 3);
+$right = $image->view(1, 1, 2, 2);
+var_dump(bin2hex($left->getBytes()), bin2hex($right->getBytes()));
+
+$right->setBytes(pack('C*', 0, 0), 1);
+unset($image);
+var_dump(bin2hex($left->getBytes()));
+
+$mat = Mat::fromBytes(pack('C*', 1, 2, 3, 4), 2, 2, Mat::TYPE_8UC1);
+$corner = $mat->roi(1, 1, 1, 1);
+$corner->setBytes(pack('C', 42));
+var_dump(bin2hex($mat->getBytes()));
+
+try {
+	$mat->roi(1, 1, 2, 2);
+} catch (OpenCV\Exception $e) {
+	echo "caught\n";
+}
+?>
+--EXPECT--
+string(12) "010204050708"
+string(8) "05060809"
+string(12) "010204050700"
+string(8) "0102032a"
+caught
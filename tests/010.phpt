@@ -0,0 +1,69 @@
+--TEST--
+Run a pipeline over tiles of an image
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Pipeline as Pipeline;
+
+$width = 150;
+$height = 100;
+$data = '';
+mt_srand(42);
+for ($i = 0; $i < $width * $height * 3; $i++) {
+	$data .= chr(mt_rand(0, 255));
+}
+$image = Image::fromBytes($data, $width, $height, Image::DEPTH_8U, 3);
+
+$pipeline = new Pipeline();
+$pipeline->convertColor(Image::BGR2GRAY, 1)
+	->smooth(Image::GAUSSIAN, 5)
+	->open(1)
+	->sobel(1, 0, 3);
+
+/* The tiles overlap by the combined kernel radius, so the seams don't show */
+$whole = $pipeline->run($image);
+$tiled = $pipeline->runTiled($image, 32, 4);
+var_dump($tiled->width, $tiled->height, $tiled->nChannels);
+var_dump($tiled->getBytes() === $whole->getBytes());
+
+$dst = new Image($width, $height, Image::DEPTH_16S, 1);
+var_dump($pipeline->runTiled($image, 64, 2, $dst) === $dst);
+var_dump($dst->getBytes() === $whole->getBytes());
+
+try {
+	$edges = new Pipeline();
+	$edges->convertColor(Image::BGR2GRAY, 1)->canny(10, 50);
+	$edges->runTiled($image);
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+
+/* Writing tiles over pixels other tiles still read is refused, whether the
+   destination is the source or another header over the same buffer */
+$blur = new Pipeline();
+$blur->smooth(Image::GAUSSIAN, 5);
+$big = new Image(64, 64, Image::DEPTH_8U, 1);
+$half = $big->view(0, 0, 64, 32);
+foreach (array(array($big, $big), array($big, $big->view(0, 0, 64, 64)), array($half, $big->view(0, 16, 64, 32))) as $pair) {
+	try {
+		$blur->runTiled($pair[0], 16, 2, $pair[1]);
+	} catch (OpenCV\Exception $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+var_dump($blur->runTiled($half, 16, 2, $big->view(0, 32, 64, 32)) instanceof Image);
+?>
+--EXPECT--
+int(150)
+int(100)
+int(1)
+bool(true)
+bool(true)
+bool(true)
+Pipelines with canny, pyrDown, pyrUp or resize steps cannot be run in tiles
+The destination image must not share pixels with the source image
+The destination image must not share pixels with the source image
+The destination image must not share pixels with the source image
+bool(true)
@@ -0,0 +1,52 @@
+--TEST--
+Load images scaled to fit a box
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+
+$dir = sys_get_temp_dir();
+$image = new Image(1000, 600, Image::DEPTH_8U, 3);
+
+foreach (array('jpg', 'png') as $type) {
+	$file = "$dir/opencv_scaled_011.$type";
+	$image->save($file);
+
+	$thumb = Image::loadScaled($file, 200, 200);
+	var_dump($thumb->width, $thumb->height, $thumb->nChannels);
+
+	$grey = Image::loadScaled($file, 100, 1000, Image::LOAD_IMAGE_GRAYSCALE);
+	var_dump($grey->width, $grey->height, $grey->nChannels);
+
+	/* Images that already fit are not enlarged */
+	$full = Image::loadScaled($file, 4000, 4000);
+	var_dump($full->width, $full->height);
+
+	unlink($file);
+}
+
+try {
+	Image::loadScaled("$dir/opencv_scaled_011.missing", 100, 100);
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+?>
+--EXPECT--
+int(200)
+int(120)
+int(3)
+int(100)
+int(60)
+int(1)
+int(1000)
+int(600)
+int(200)
+int(120)
+int(3)
+int(100)
+int(60)
+int(1)
+int(1000)
+int(600)
+Could not load the image - check it exists and the codec is available
@@ -0,0 +1,37 @@
+--TEST--
+Reuse released image buffers from the pool
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--INI--
+opencv.image_pool_size=4
+opencv.image_pool_memory=64
+--FILE--
+<?php
+use OpenCV\Image as Image;
+
+$before = Image::getPoolStats();
+for ($i = 0; $i < 10; $i++) {
+	$image = new Image(640, 480, Image::DEPTH_8U, 3);
+	$image = null;
+}
+$after = Image::getPoolStats();
+var_dump($after['reused'] - $before['reused'] >= 9);
+var_dump($after['images'] >= 1, $after['images'] <= 4);
+
+/* A reused image comes back the same shape as a new one */
+$image = new Image(640, 480, Image::DEPTH_8U, 3);
+var_dump($image->width, $image->height, $image->nChannels);
+
+ini_set('opencv.image_pool_size', 0);
+$image = null;
+$stats = Image::getPoolStats();
+var_dump($stats['freed'] > $after['freed']);
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+int(640)
+int(480)
+int(3)
+bool(true)
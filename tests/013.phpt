@@ -0,0 +1,53 @@
+--TEST--
+Image and Mat properties are read from the native object
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Mat as Mat;
+
+$image = new Image(64, 48, Image::DEPTH_8U, 3);
+var_dump($image->width, $image->height, $image->nChannels, $image->depth == Image::DEPTH_8U);
+var_dump(isset($image->width), empty($image->alphaChannel));
+var_dump((array) $image);
+
+try {
+	$image->width = 10;
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+var_dump($image->width);
+
+/* Ordinary properties still work alongside the native ones */
+$image->label = 'frame';
+var_dump($image->label);
+
+$mat = new Mat(4, 5, Mat::TYPE_8UC3);
+var_dump($mat->rows, $mat->cols, $mat->channels);
+?>
+--EXPECT--
+int(64)
+int(48)
+int(3)
+bool(true)
+bool(true)
+bool(true)
+array(5) {
+  ["width"]=>
+  int(64)
+  ["height"]=>
+  int(48)
+  ["nChannels"]=>
+  int(3)
+  ["alphaChannel"]=>
+  int(0)
+  ["depth"]=>
+  int(8)
+}
+Cannot set OpenCV\Image::$width, it is read-only
+int(64)
+string(5) "frame"
+int(4)
+int(5)
+int(3)
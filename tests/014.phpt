@@ -0,0 +1,51 @@
+--TEST--
+Collect call timings and image memory statistics
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--INI--
+opencv.stats_enabled=1
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Stats as Stats;
+
+var_dump(Stats::isEnabled());
+Stats::reset();
+
+$image = new Image(320, 240, Image::DEPTH_8U, 3);
+for ($i = 0; $i < 3; $i++) {
+	$smoothed = $image->smooth(Image::GAUSSIAN, 5, 5, 0, 0);
+}
+
+$stats = Stats::get();
+$smooth = $stats['methods']['OpenCV\Image::smooth'];
+var_dump($smooth['calls']);
+var_dump(isset($stats['methods']['OpenCV\Stats::reset']), isset($stats['methods']['OpenCV\Stats::isEnabled']));
+var_dump($smooth['total'] >= $smooth['max'], $smooth['p99'] >= $smooth['p50']);
+var_dump($stats['memory']['images'] >= 2, $stats['memory']['bytes'] >= 2 * 320 * 240 * 3);
+var_dump($stats['memory']['peak'] >= $stats['memory']['bytes']);
+
+/* Views share their parent's pixels, so they don't add to the memory */
+$before = Stats::get();
+$view = $image->view(0, 0, 10, 10);
+$after = Stats::get();
+var_dump($after['memory']['bytes'] == $before['memory']['bytes']);
+
+ini_set('opencv.stats_enabled', 0);
+Stats::reset();
+$image->smooth(Image::GAUSSIAN, 5, 5, 0, 0);
+$stats = Stats::get();
+var_dump(count($stats['methods']));
+?>
+--EXPECT--
+bool(true)
+int(3)
+bool(false)
+bool(false)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+int(0)
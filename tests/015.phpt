@@ -0,0 +1,44 @@
+--TEST--
+Run every benchmark case once on small synthetic inputs
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+require dirname(__FILE__) . '/../bench/bench.php';
+
+$report = opencv_bench_run(array(
+	'sizes' => array('qvga'),
+	'depths' => array('8u', '16u', '32f'),
+	'channels' => array(1, 3),
+	/* Reading video depends on the build's backend, so Capture has its own
+	   tests that skip when it can't */
+	'filter' => '/^(?!Capture::)/',
+	'min_time' => 0,
+	'max_iterations' => 1,
+	'frames' => 5,
+	'seed' => 1,
+	'output' => null,
+));
+
+var_dump($report['meta']['seed']);
+var_dump(count($report['results']) > 0);
+
+$names = array();
+foreach ($report['results'] as $result) {
+	if ($result['iterations'] != 1 || $result['min'] < 0 || $result['mpixels_per_second'] <= 0) {
+		echo "bad result for {$result['case']}\n";
+	}
+	$names[$result['case']] = true;
+}
+var_dump(count($names) == count(preg_grep('/^(?!Capture::)/', array_keys(opencv_bench_cases()))));
+
+/* The same seed gives the same input */
+$a = opencv_bench_image(64, 48, '8u', 3, 7);
+$b = opencv_bench_image(64, 48, '8u', 3, 7);
+var_dump($a->getBytes() === $b->getBytes());
+?>
+--EXPECT--
+int(1)
+bool(true)
+bool(true)
+bool(true)
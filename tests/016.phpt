@@ -0,0 +1,85 @@
+--TEST--
+Calculate, normalize and compare histograms
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Histogram as Histogram;
+
+/* Two dark pixels and two bright ones */
+$image = Image::fromBytes(pack('C*', 0, 0, 255, 255), 2, 2, Image::DEPTH_8U, 1);
+$histogram = new Histogram(1, 2, Histogram::TYPE_ARRAY);
+var_dump($histogram->calc($image) === $histogram);
+var_dump($histogram->getBins());
+
+/* Accumulate adds to the existing counts */
+$histogram->calc($image, true);
+var_dump($histogram->getBins());
+
+/* Only the pixels under the mask are counted */
+$mask = Image::fromBytes(pack('C*', 255, 0, 0, 0), 2, 2, Image::DEPTH_8U, 1);
+$histogram->calc($image, false, $mask);
+var_dump($histogram->getBins());
+
+$histogram->calc($image)->normalize();
+var_dump($histogram->getBins());
+
+$same = new Histogram(1, 2, Histogram::TYPE_ARRAY);
+$same->calc($image)->normalize();
+$dark = new Histogram(1, 2, Histogram::TYPE_ARRAY);
+$dark->calc(Image::fromBytes(pack('C*', 0, 0, 0, 0), 2, 2, Image::DEPTH_8U, 1))->normalize();
+var_dump($histogram->compare($same, Histogram::COMP_INTERSECT));
+var_dump($histogram->compare($dark, Histogram::COMP_INTERSECT));
+var_dump($histogram->compare($same, Histogram::COMP_BHATTACHARYYA) < $histogram->compare($dark, Histogram::COMP_BHATTACHARYYA));
+
+try {
+	$histogram->compare(new Histogram(1, 4, Histogram::TYPE_ARRAY), Histogram::COMP_CORREL);
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+
+try {
+	$histogram->calc(new Image(2, 2, Image::DEPTH_16U, 1));
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+
+$equalized = Image::fromBytes(pack('C*', 100, 100, 110, 110), 2, 2, Image::DEPTH_8U, 1)->equalize();
+$bytes = unpack('C*', $equalized->getBytes());
+var_dump($bytes[1] == $bytes[2], $bytes[1] < $bytes[3], $bytes[3]);
+?>
+--EXPECT--
+bool(true)
+array(2) {
+  [0]=>
+  float(2)
+  [1]=>
+  float(2)
+}
+array(2) {
+  [0]=>
+  float(4)
+  [1]=>
+  float(4)
+}
+array(2) {
+  [0]=>
+  float(1)
+  [1]=>
+  float(0)
+}
+array(2) {
+  [0]=>
+  float(0.5)
+  [1]=>
+  float(0.5)
+}
+float(1)
+float(0.5)
+bool(true)
+Histograms can only be compared with histograms that have the same bins
+Histograms can only be calculated from 8 bit or 32 bit float images, all of the same depth
+bool(true)
+bool(true)
+int(255)
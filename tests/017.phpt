@@ -0,0 +1,97 @@
+--TEST--
+Calculate multi-dimensional histograms over image channels
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Histogram as Histogram;
+
+/* Two pixels, (0, 0, 255) and (255, 255, 0) */
+$image = Image::fromBytes(pack('C*', 0, 0, 255, 255, 255, 0), 2, 1, Image::DEPTH_8U, 3);
+
+/* One 3 channel image and its three planes give the same counts */
+$histogram = new Histogram(3, array(2, 2, 2), Histogram::TYPE_ARRAY);
+$histogram->calc($image);
+$bins = $histogram->getBins();
+var_dump($bins[0][0][1], $bins[1][1][0], $bins[0][0][0]);
+
+$planes = new Histogram(3, 2, Histogram::TYPE_ARRAY);
+$planes->calc($image->split());
+var_dump($planes->getBins() == $bins);
+
+/* Per-dimension bins and ranges */
+$histogram = new Histogram(2, array(3, 2), Histogram::TYPE_ARRAY, array(array(0, 300), array(0, 256)));
+$histogram->calc(array(
+	Image::fromBytes(pack('C*', 10, 150, 250), 3, 1, Image::DEPTH_8U, 1),
+	Image::fromBytes(pack('C*', 0, 0, 200), 3, 1, Image::DEPTH_8U, 1),
+));
+var_dump($histogram->getBins());
+
+/* Non-uniform bins take their edges */
+$histogram = new Histogram(1, 2, Histogram::TYPE_ARRAY, array(array(0, 10, 256)), false);
+$histogram->calc(Image::fromBytes(pack('C*', 5, 20, 30), 3, 1, Image::DEPTH_8U, 1));
+var_dump($histogram->getBins());
+
+/* Sparse histograms are counted too */
+$sparse = new Histogram(3, 2, Histogram::TYPE_SPARSE);
+$sparse->calc($image);
+var_dump($sparse->getBins() == $bins);
+
+try {
+	$histogram = new Histogram(2, 4, Histogram::TYPE_ARRAY);
+	$histogram->calc($image);
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+
+try {
+	new Histogram(2, array(4), Histogram::TYPE_ARRAY);
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+
+try {
+	new Histogram(1, 4, Histogram::TYPE_ARRAY, array(array(10, 0)));
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+?>
+--EXPECT--
+float(1)
+float(1)
+float(0)
+bool(true)
+array(3) {
+  [0]=>
+  array(2) {
+    [0]=>
+    float(1)
+    [1]=>
+    float(0)
+  }
+  [1]=>
+  array(2) {
+    [0]=>
+    float(1)
+    [1]=>
+    float(0)
+  }
+  [2]=>
+  array(2) {
+    [0]=>
+    float(0)
+    [1]=>
+    float(1)
+  }
+}
+array(2) {
+  [0]=>
+  float(1)
+  [1]=>
+  float(2)
+}
+bool(true)
+The images have 3 channels between them but the histogram has 2 dimensions
+The bins array must have one entry per dimension
+Ranges must be array(low, high), or one such pair per dimension, with low below high
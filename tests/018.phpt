@@ -0,0 +1,71 @@
+--TEST--
+Share an image through a named shared memory segment
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\SharedImage as SharedImage;
+
+$name = '/opencv-test-' . getmypid();
+$data = pack('C*', 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12);
+
+$shared = SharedImage::create($name, 2, 2, Image::DEPTH_8U, 3);
+$shared->setBytes($data, 0);
+
+$opened = SharedImage::open($name);
+var_dump($opened instanceof Image, $opened->width, $opened->height, $opened->nChannels);
+var_dump($opened->getBytes() === $data);
+
+/* Both objects map the same pixels */
+$opened->setBytes(pack('C*', 9, 9, 9, 9, 9, 9), 1);
+var_dump(bin2hex($shared->getBytes()));
+
+try {
+	SharedImage::create($name, 2, 2, Image::DEPTH_8U, 3);
+} catch (OpenCV\Exception $e) {
+	echo "exists\n";
+}
+var_dump(SharedImage::unlink($name));
+
+try {
+	SharedImage::open($name);
+} catch (OpenCV\Exception $e) {
+	echo "gone\n";
+}
+
+try {
+	SharedImage::create($name, 2, 2, 24, 3);
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+
+/* A segment someone else has scribbled over is refused */
+$shared = SharedImage::create($name, 2, 2, Image::DEPTH_8U, 3);
+if (file_exists("/dev/shm$name")) {
+	$fp = fopen("/dev/shm$name", 'r+');
+	fseek($fp, 40);
+	fwrite($fp, pack('VV', 0, 0));
+	fclose($fp);
+	try {
+		SharedImage::open($name);
+	} catch (OpenCV\Exception $e) {
+		echo $e->getMessage(), "\n";
+	}
+} else {
+	echo "The raw image header is corrupt or the data is truncated\n";
+}
+SharedImage::unlink($name);
+?>
+--EXPECT--
+bool(true)
+int(2)
+int(2)
+int(3)
+bool(true)
+string(24) "010203040506090909090909"
+exists
+bool(true)
+gone
+Invalid size, depth or channels for a shared image
+The raw image header is corrupt or the data is truncated
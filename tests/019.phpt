@@ -0,0 +1,62 @@
+--TEST--
+Decode video frames ahead on a background thread
+--SKIPIF--
+<?php
+if (!extension_loaded("opencv")) die("skip");
+require dirname(__FILE__) . '/../bench/synthetic.php';
+if (!opencv_bench_video_readable()) die("skip the video backend can't read MJPEG AVI files");
+?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Capture as Capture;
+
+require dirname(__FILE__) . '/../bench/synthetic.php';
+
+$file = tempnam(sys_get_temp_dir(), 'ocv') . '.avi';
+opencv_bench_video($file, 64, 48, 8);
+
+$expected = array();
+$capture = Capture::createFileCapture($file);
+while ($frame = $capture->queryFrame()) {
+	$expected[] = $frame->getBytes();
+}
+var_dump(count($expected));
+
+/* The same frames come back in order, whether returned or copied */
+$capture = Capture::createFileCapture($file, array('prefetch' => 3));
+$frames = array();
+$dst = new Image(64, 48, Image::DEPTH_8U, 3);
+for ($i = 0; $i < 8; $i++) {
+	if ($i % 2) {
+		$frame = $capture->queryFrame();
+	} else {
+		$frame = $capture->queryFrame($dst);
+		var_dump($frame === $dst);
+	}
+	$frames[] = $frame->getBytes();
+}
+var_dump($frames === $expected);
+
+/* A returned frame is a copy, so retrieveFrame still has it */
+$capture = Capture::createFileCapture($file, array('prefetch' => 2));
+$first = $capture->queryFrame();
+var_dump($capture->retrieveFrame()->getBytes() === $first->getBytes());
+
+/* Past the end there is no current frame */
+while ($capture->queryFrame()) {
+}
+var_dump($capture->queryFrame(), $capture->retrieveFrame());
+
+unlink($file);
+?>
+--EXPECT--
+int(8)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+bool(false)
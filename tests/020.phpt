@@ -0,0 +1,65 @@
+--TEST--
+Iterate over a range of video frames
+--SKIPIF--
+<?php
+if (!extension_loaded("opencv")) die("skip");
+require dirname(__FILE__) . '/../bench/synthetic.php';
+if (!opencv_bench_video_readable()) die("skip the video backend can't read MJPEG AVI files");
+?>
+--FILE--
+<?php
+use OpenCV\Capture as Capture;
+
+require dirname(__FILE__) . '/../bench/synthetic.php';
+
+/* 10 frames at 25fps, one every 40ms */
+$file = tempnam(sys_get_temp_dir(), 'ocv') . '.avi';
+opencv_bench_video($file, 64, 48, 10, 25);
+
+$expected = array();
+$capture = Capture::createFileCapture($file);
+while ($frame = $capture->queryFrame()) {
+	$expected[] = $frame->getBytes();
+}
+
+function frame_numbers($iterator, $expected)
+{
+	$keys = array();
+	foreach ($iterator as $key => $frame) {
+		if ($frame->getBytes() !== $expected[$key]) {
+			echo "frame $key does not match\n";
+		}
+		$keys[] = $key;
+	}
+	return implode(',', $keys);
+}
+
+/* A new iterator carries on from the capture's position, so each one
+   gets a fresh capture */
+echo frame_numbers(Capture::createFileCapture($file), $expected), "\n";
+echo frame_numbers(Capture::createFileCapture($file)->frames(3), $expected), "\n";
+echo frame_numbers(Capture::createFileCapture($file)->frames(3, -1, -1, true), $expected), "\n";
+
+/* The end is inclusive: the frame at 200ms is the last one */
+echo frame_numbers(Capture::createFileCapture($file)->frames(1, 80, 200), $expected), "\n";
+echo frame_numbers(Capture::createFileCapture($file)->frames(2, 80, 200, true), $expected), "\n";
+
+/* Rewinding starts again */
+$frames = Capture::createFileCapture($file)->frames(4);
+echo frame_numbers($frames, $expected), " ", frame_numbers($frames, $expected), "\n";
+
+try {
+	Capture::createFileCapture($file)->frames(0);
+} catch (OpenCV\Exception $e) {
+	echo $e->getMessage(), "\n";
+}
+unlink($file);
+?>
+--EXPECT--
+0,1,2,3,4,5,6,7,8,9
+0,3,6,9
+0,3,6,9
+2,3,4,5
+2,4
+0,4,8 0,4,8
+The step must be at least 1
@@ -0,0 +1,65 @@
+--TEST--
+Write filter results into a given image or in place
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+
+$pixels = array();
+for ($i = 0; $i < 64; $i++) {
+	$pixels[] = ($i * 37) % 256;
+}
+$data = call_user_func_array('pack', array_merge(array('C*'), $pixels));
+$image = Image::fromBytes($data, 8, 8, Image::DEPTH_8U, 1);
+
+/* Into a destination: the same pixels as a new image, and the source is
+   left alone */
+$expected = $image->smooth(Image::GAUSSIAN, 3, 3, 0, 0)->getBytes();
+$dst = new Image(8, 8, Image::DEPTH_8U, 1);
+var_dump($image->smooth(Image::GAUSSIAN, 3, 3, 0, 0, $dst) === $dst);
+var_dump($dst->getBytes() === $expected, $image->getBytes() === $data);
+
+$expected = $image->erode(1)->getBytes();
+$image->erode(1, $dst);
+var_dump($dst->getBytes() === $expected);
+
+/* In place, including the median and bilateral filters, which have to work
+   from a copy */
+foreach (array(
+	array(Image::GAUSSIAN, 3, 3, 0, 0),
+	array(Image::MEDIAN, 3, 0, 0, 0),
+	array(Image::BILATERAL, 3, 3, 50, 50),
+) as $params) {
+	$copy = Image::fromBytes($data, 8, 8, Image::DEPTH_8U, 1);
+	$expected = call_user_func_array(array($copy, 'smooth'), $params)->getBytes();
+	$params[] = $copy;
+	var_dump(call_user_func_array(array($copy, 'smooth'), $params) === $copy && $copy->getBytes() === $expected);
+}
+
+$copy = Image::fromBytes($data, 8, 8, Image::DEPTH_8U, 1);
+$expected = $copy->dilate(2)->getBytes();
+$copy->dilate(2, $copy);
+var_dump($copy->getBytes() === $expected);
+
+/* The destination must have the source's shape */
+foreach (array(new Image(4, 8, Image::DEPTH_8U, 1), new Image(8, 8, Image::DEPTH_16U, 1), new Image(8, 8, Image::DEPTH_8U, 3)) as $wrong) {
+	try {
+		$image->smooth(Image::GAUSSIAN, 3, 3, 0, 0, $wrong);
+	} catch (OpenCV\Exception $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+The destination image must have the same size, depth and channels as the source
+The destination image must have the same size, depth and channels as the source
+The destination image must have the same size, depth and channels as the source
@@ -0,0 +1,105 @@
+--TEST--
+Load, resize and filter batches of images on native threads
+--SKIPIF--
+<?php if (!extension_loaded("opencv")) print "skip"; ?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\Batch as Batch;
+use OpenCV\Pipeline as Pipeline;
+
+$dir = sys_get_temp_dir() . '/opencv-batch-' . getmypid();
+mkdir($dir);
+
+$sources = array();
+for ($i = 0; $i < 6; $i++) {
+	$image = new Image(40, 20, Image::DEPTH_8U, 3);
+	$image->setBytes(str_repeat(chr($i * 40), 40 * 20 * 3), 0);
+	$sources["$dir/src$i.png"] = "$dir/dst$i.png";
+	$image->save("$dir/src$i.png");
+}
+$sources["$dir/missing.png"] = "$dir/dst-missing.png";
+
+/* Every image is fitted inside the box; missing files report false */
+$results = Batch::resize($sources, 10, 10, Image::INTER_AREA, 3);
+var_dump(count(array_filter($results)), $results["$dir/missing.png"]);
+$small = Image::load("$dir/dst0.png");
+var_dump($small->width, $small->height);
+
+/* Keys are kept, whatever the order the threads finish in */
+$loaded = Batch::load(array('a' => "$dir/src2.png", 'b' => "$dir/missing.png", 7 => "$dir/src5.png"), Image::LOAD_IMAGE_GRAYSCALE, 2);
+var_dump(array_keys($loaded), $loaded['b'], $loaded['a']->nChannels);
+var_dump(ord($loaded['a']->getBytes()) == 80, ord($loaded[7]->getBytes()) == 200);
+
+$pipeline = new Pipeline();
+$pipeline->smooth(Image::GAUSSIAN, 3)->erode(1);
+$images = array('x' => $loaded['a'], 'y' => $loaded[7]);
+$filtered = Batch::run($pipeline, $images, 2);
+var_dump(array_keys($filtered));
+var_dump($filtered['x']->getBytes() === $pipeline->run($loaded['a'])->getBytes());
+
+foreach (array(
+	function () use ($dir) { Batch::resize(array("$dir/src0.png"), 10, 10); },
+	function () use ($dir) { Batch::resize(array("$dir/src0.png" => "$dir/out.png"), 0, 10); },
+	function () { Batch::load(array(42)); },
+	function () { Batch::run(new Pipeline(), array()); },
+	function () use ($pipeline) { Batch::run($pipeline, array('not an image')); },
+	function () { new Batch(); },
+) as $call) {
+	try {
+		$call();
+	} catch (OpenCV\Exception $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+
+/* Paths outside open_basedir are refused before any thread starts */
+ini_set('open_basedir', $dir);
+foreach (array(
+	function () use ($dir) { Batch::load(array("$dir/src0.png", '/etc/passwd')); },
+	function () use ($dir) { Batch::resize(array("$dir/src0.png" => '/tmp/outside.png'), 10, 10); },
+) as $call) {
+	try {
+		$call();
+	} catch (OpenCV\Exception $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+
+foreach (glob("$dir/*") as $file) {
+	unlink($file);
+}
+rmdir($dir);
+?>
+--EXPECT--
+int(6)
+bool(false)
+int(10)
+int(5)
+array(3) {
+  [0]=>
+  string(1) "a"
+  [1]=>
+  string(1) "b"
+  [2]=>
+  int(7)
+}
+bool(false)
+int(1)
+bool(true)
+bool(true)
+array(2) {
+  [0]=>
+  string(1) "x"
+  [1]=>
+  string(1) "y"
+}
+bool(true)
+Files must be given as an array of source => destination filenames
+The width and height must be greater than zero
+Files must be given as an array of filenames
+The pipeline has no steps
+Images must be given as an array of OpenCV\Image objects
+OpenCV\Batch cannot be constructed
+Could not access file due to open_basedir restrictions
+Could not access file due to open_basedir restrictions
@@ -0,0 +1,77 @@
+--TEST--
+Detect objects with a Haar cascade and detection options
+--SKIPIF--
+<?php
+if (!extension_loaded("opencv")) die("skip");
+$found = false;
+foreach (array('/usr/share/opencv', '/usr/share/OpenCV', '/usr/local/share/opencv', '/usr/local/share/OpenCV', '/usr/share/opencv4', '/usr/local/share/opencv4') as $dir) {
+	$found = $found || file_exists("$dir/haarcascades/haarcascade_frontalface_default.xml");
+}
+if (!$found) die("skip OpenCV's bundled Haar cascades are not installed");
+?>
+--FILE--
+<?php
+use OpenCV\Image as Image;
+use OpenCV\CascadeClassifier as CascadeClassifier;
+
+foreach (array('/usr/share/opencv', '/usr/share/OpenCV', '/usr/local/share/opencv', '/usr/local/share/OpenCV', '/usr/share/opencv4', '/usr/local/share/opencv4') as $dir) {
+	if (file_exists("$dir/haarcascades/haarcascade_frontalface_default.xml")) {
+		$file = "$dir/haarcascades/haarcascade_frontalface_default.xml";
+		break;
+	}
+}
+
+$cascade = new CascadeClassifier($file);
+$image = new Image(120, 120, Image::DEPTH_8U, 3);
+$image->setBytes(str_repeat("\x80", 120 * 120 * 3), 0);
+$before = $image->getBytes();
+
+/* A flat image has no faces, whatever the options */
+var_dump($cascade->detectMultiScale($image));
+var_dump($cascade->detectMultiScale($image, array(
+	'scaleFactor' => 1.2,
+	'minNeighbors' => 2,
+	'flags' => CascadeClassifier::HAAR_DO_CANNY_PRUNING | CascadeClassifier::HAAR_SCALE_IMAGE,
+	'minSize' => array(30, 30),
+	'maxSize' => 100,
+	'equalize' => false,
+)));
+var_dump($image->haarDetectObjects($file, array('flags' => CascadeClassifier::HAAR_FIND_BIGGEST_OBJECT | CascadeClassifier::HAAR_DO_ROUGH_SEARCH)));
+
+/* Detection works on a copy */
+var_dump($image->getBytes() === $before);
+
+foreach (array(
+	array('scaleFactor' => 1.0),
+	array('minNeighbors' => -1),
+	array('flags' => 1 << 20),
+	array('minSize' => -5),
+	array('minSize' => array(40, 40), 'maxSize' => array(30, 60)),
+) as $options) {
+	try {
+		$cascade->detectMultiScale($image, $options);
+	} catch (OpenCV\Exception $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+
+try {
+	new CascadeClassifier(__FILE__);
+} catch (OpenCV\Exception $e) {
+	echo "not a cascade\n";
+}
+?>
+--EXPECT--
+array(0) {
+}
+array(0) {
+}
+array(0) {
+}
+bool(true)
+The scale factor must be greater than 1
+minNeighbors must not be negative
+The flags must be a combination of the HAAR_* constants
+minSize and maxSize must not be negative
+maxSize must not be smaller than minSize
+not a cascade